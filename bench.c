@@ -0,0 +1,301 @@
+#include "game.h"
+
+// Headless rendering benchmarks for game.c (no terminal output).
+// Scene runs print per-stage timings and a framebuffer checksum; identical
+// checksums across builds mean a change did not alter the rendered frames.
+
+#define WU_BENCH_LINES 2000
+#define WU_BENCH_REPS 50
+
+typedef void (*LineFunc)(Vec3, Vec3, int, int, Color, FrameBuffer *);
+
+static Vec3 line_start[WU_BENCH_LINES];
+static Vec3 line_end[WU_BENCH_LINES];
+static Color line_color[WU_BENCH_LINES];
+static Color reference_colors[HEIGHT][WIDTH];     // Lines run at the default output size
+
+// Scene header labels, indexed by COLOR_MODE_* and RUN_ENCODING_*
+static const char *color_mode_names[] = {"truecolor", "256 colors", "16 colors"};
+static const char *run_encoding_names[] = {"", ", ECH/CUF runs", ", REP runs"};
+
+// Deterministic pseudo-random numbers so runs are comparable
+static unsigned int bench_seed = 12345;
+
+static double bench_random(double lo, double hi) {
+    bench_seed = bench_seed * 1103515245u + 12345u;
+    return lo + (hi - lo) * ((bench_seed >> 8) & 0xFFFF) / 65535.0;
+}
+
+// Screen-space length of a line's major axis, i.e. how many columns/rows Wu
+// steps for it (camera at the origin looking down +z)
+static double major_axis_pixels(Vec3 a, Vec3 b) {
+    double fov_scale = 1.0 / tan(FOV * PI / 180.0 / 2.0);
+    double scale_x = fov_scale * (WIDTH / 2);
+    double scale_y = fov_scale * ((double)WIDTH / HEIGHT) * (HEIGHT / 2);
+    double dx = fabs(a.x / a.z - b.x / b.z) * scale_x;
+    double dy = fabs(a.y / a.z - b.y / b.z) * scale_y;
+    return (dx > dy ? dx : dy) + 1.0;
+}
+
+static void make_lines(void) {
+    bench_seed = 12345;
+    for (int i = 0; i < WU_BENCH_LINES; i++) {
+        // Keep both ends in front of the camera and on screen
+        double z0 = bench_random(4.0, 40.0);
+        double z1 = bench_random(4.0, 40.0);
+        line_start[i] = (Vec3){bench_random(-0.8, 0.8) * z0, bench_random(-0.4, 0.4) * z0, z0};
+        line_end[i] = (Vec3){bench_random(-0.8, 0.8) * z1, bench_random(-0.4, 0.4) * z1, z1};
+        line_color[i] = (Color){(unsigned char)bench_random(0, 255),
+                                (unsigned char)bench_random(0, 255),
+                                (unsigned char)bench_random(0, 255), 0};
+    }
+}
+
+static void draw_lines(LineFunc draw) {
+    for (int i = 0; i < WU_BENCH_LINES; i++)
+        draw(line_start[i], line_end[i], WIDTH, HEIGHT, line_color[i], &screen);
+}
+
+// Seconds spent drawing every line WU_BENCH_REPS times (clears not counted)
+static double time_lines(LineFunc draw) {
+    double total = 0.0;
+    for (int rep = 0; rep < WU_BENCH_REPS; rep++) {
+        clearScreen();
+        double start = getMonotonicTime();
+        draw_lines(draw);
+        total += getMonotonicTime() - start;
+    }
+    return total;
+}
+
+static void bench_wu_lines(void) {
+    setHalfBlockMode(0);
+    setOutputSize(WIDTH, HEIGHT);
+    moveCamera((Vec3){0.0, 0.0, 0.0});
+    setCameraRotation(0.0);
+    make_lines();
+
+    double pixels = 0.0;
+    for (int i = 0; i < WU_BENCH_LINES; i++)
+        pixels += 2.0 * major_axis_pixels(line_start[i], line_end[i]);
+    pixels *= WU_BENCH_REPS;
+
+    // Each line alone through both versions, compared channel by channel.
+    // (Overlapping lines can also differ through depth-test ties.)
+    int differing = 0, max_diff = 0;
+    for (int i = 0; i < WU_BENCH_LINES; i++) {
+        clearScreen();
+        drawLineZ_WuFloat(line_start[i], line_end[i], WIDTH, HEIGHT, line_color[i], &screen);
+        memcpy(reference_colors, screen.color, sizeof(reference_colors));
+        clearScreen();
+        drawLineZ_Wu(line_start[i], line_end[i], WIDTH, HEIGHT, line_color[i], &screen);
+        for (int y = 0; y < HEIGHT; y++) {
+            for (int x = 0; x < WIDTH; x++) {
+                Color a = reference_colors[y][x], b = FRAME_COLOR(&screen)[y][x];
+                int d = abs(a.red - b.red);
+                if (abs(a.green - b.green) > d) d = abs(a.green - b.green);
+                if (abs(a.blue - b.blue) > d) d = abs(a.blue - b.blue);
+                if (d > 0) differing++;
+                if (d > max_diff) max_diff = d;
+            }
+        }
+    }
+
+    double float_time = time_lines(drawLineZ_WuFloat);
+    double fixed_time = time_lines(drawLineZ_Wu);
+
+    printf("Wu lines: %d lines x %d reps, ~%.0f pixels per pass\n",
+           WU_BENCH_LINES, WU_BENCH_REPS, pixels / WU_BENCH_REPS);
+    printf("  float reference: %8.2f Mpixels/s (%.2f ms/pass)\n",
+           pixels / float_time / 1e6, float_time * 1000.0 / WU_BENCH_REPS);
+    printf("  fixed point:     %8.2f Mpixels/s (%.2f ms/pass)  x%.2f\n",
+           pixels / fixed_time / 1e6, fixed_time * 1000.0 / WU_BENCH_REPS, float_time / fixed_time);
+    printf("  difference per line: %d pixels in total, max %d per channel\n", differing, max_diff);
+}
+
+// ============== SCENE BENCHMARK ==============
+
+// Players stand on a ring around the origin; the camera orbits inside it
+#define SCENE_RING_RADIUS 10.0
+#define SCENE_CAMERA_RADIUS 6.0
+#define SCENE_FRAME_DT (1.0 / 60.0)
+
+typedef struct {
+    int num_players;
+    int num_projectiles;
+    int frames;
+    int threads;
+    int half_block;
+    short color_mode;
+    short run_encoding;
+} SceneConfig;
+
+// Time spent per pipeline stage over a run, in seconds
+typedef struct {
+    double clear;
+    double draw;
+    double aa;
+    double frame;
+    unsigned long frame_bytes;
+    uint64_t checksum;
+} StageTimes;
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void setup_scene(const SceneConfig *config) {
+    initProjectileQueue(&projectileQueue);
+    for (int i = 0; i < 16; i++) players[i].hp = 0;
+
+    for (int i = 0; i < config->num_players; i++) {
+        double angle = 2.0 * PI * i / config->num_players;
+        Vec3 position = {cos(angle) * SCENE_RING_RADIUS, 0.5 * (i % 3), sin(angle) * SCENE_RING_RADIUS};
+        players[i].cuboid = (Cuboid){position, 2.0, 2.0, 2.0, angle * 1.7,
+                                     {40, (unsigned char)(255 - 12 * i), (unsigned char)(15 * i), 0}};
+        players[i].gun = (Gun){{position.x, position.y - 0.5, position.z}, 4.0, angle * 1.7, {255, 0, 0, 0}};
+        players[i].hp = 5;
+    }
+
+    // Projectiles fan out from the center so they cross the whole view
+    for (int i = 0; i < config->num_projectiles; i++) {
+        Projectile proj = {
+            .position = {bench_random(-3.0, 3.0), bench_random(-1.0, 1.5), bench_random(-3.0, 3.0)},
+            .length = 3.0,
+            .rotation_y = 2.0 * PI * i / config->num_projectiles,
+            .color = {255, 255, 255},
+            .distance_left = PROJECTILE_TRAVEL_DISTANCE,
+            .speed = PROJECTILE_TRAVEL_SPEED,
+            .ownerID = 0,
+            .collided = 0
+        };
+        enqueueProjectile(&projectileQueue, proj);
+    }
+}
+
+// Render config->frames frames of an orbiting camera through the same
+// stages as the client loop, timing each stage
+static StageTimes run_scene(const SceneConfig *config, short msaa, short post_process) {
+    StageTimes times = {0};
+    times.checksum = 14695981039346656037ULL;
+
+    bench_seed = 12345;
+    setup_scene(config);
+    setActiveMSAA(msaa);
+    setPostProcess(post_process);
+    invalidateFrame();
+
+    for (int f = 0; f < config->frames; f++) {
+        double yaw = 2.0 * PI * f / config->frames;
+        moveCamera((Vec3){-sin(yaw) * SCENE_CAMERA_RADIUS, 1.0, -cos(yaw) * SCENE_CAMERA_RADIUS});
+        setCameraRotation(yaw);
+
+        double t0 = getMonotonicTime();
+        clearScreen();
+        double t1 = getMonotonicTime();
+        drawProjectiles(&projectileQueue);
+        drawAllPlayers();
+        double t2 = getMonotonicTime();
+        if (post_process == POST_PROCESS_AA) applyAA();
+        double t3 = getMonotonicTime();
+        generateframeString();
+        double t4 = getMonotonicTime();
+
+        times.clear += t1 - t0;
+        times.draw += t2 - t1;
+        times.aa += t3 - t2;
+        times.frame += t4 - t3;
+        times.frame_bytes += frameStringSize;
+
+        const FrameBuffer *out = post_process == POST_PROCESS_AA ? &antiAliased : &screen;
+        size_t count = (size_t)out->width * out->height;
+        times.checksum = fnv1a(times.checksum, out->color, count * sizeof(Color));
+        times.checksum = fnv1a(times.checksum, out->pixels, count);
+
+        updateProjectiles(&projectileQueue, players, 16, SCENE_FRAME_DT, 0, NULL, NULL);
+    }
+    return times;
+}
+
+static void print_stage_times(const char *name, const SceneConfig *config, StageTimes times) {
+    double per_frame = 1000.0 / config->frames;
+    double total = times.clear + times.draw + times.aa + times.frame;
+    printf("%-10s clear %6.3f  draw %6.3f  aa %6.3f  frame %6.3f  total %6.3f ms/frame  %7lu B/frame  checksum %016llx\n",
+           name,
+           times.clear * per_frame, times.draw * per_frame, times.aa * per_frame,
+           times.frame * per_frame, total * per_frame,
+           times.frame_bytes / config->frames, (unsigned long long)times.checksum);
+}
+
+static void bench_scenes(const SceneConfig *config) {
+    setRasterThreads(config->threads);
+    setHalfBlockMode(config->half_block);
+    setOutputSize(WIDTH, HEIGHT);
+    setColorMode(config->color_mode);
+    setRunEncoding(config->run_encoding);
+    printf("Scene: %d players, %d projectiles, %d frames, %d raster threads, %s%s%s\n",
+           config->num_players, config->num_projectiles, config->frames, config->threads,
+           color_mode_names[config->color_mode], config->half_block ? ", half-block" : "",
+           run_encoding_names[config->run_encoding]);
+    print_stage_times("noaa", config, run_scene(config, 0, POST_PROCESS_NONE));
+    print_stage_times("msaa", config, run_scene(config, 1, POST_PROCESS_NONE));
+    print_stage_times("noaa+post", config, run_scene(config, 0, POST_PROCESS_AA));
+    print_stage_times("msaa+post", config, run_scene(config, 1, POST_PROCESS_AA));
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "Usage: %s [--players N] [--projectiles M] [--frames F] [--threads T] [--half-block] [--colors truecolor|256|16]\n"
+            "       [--run-encoding none|erase|repeat] [--scenes-only | --lines-only]\n",
+            program);
+    exit(1);
+}
+
+int main(int argc, char *argv[]) {
+    SceneConfig config = {16, 32, 240, 1, 0, COLOR_MODE_TRUECOLOR, RUN_ENCODING_NONE};
+    int run_lines = 1, run_scenes = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--players") == 0 && i + 1 < argc) {
+            config.num_players = atoi(argv[++i]);
+            if (config.num_players < 0 || config.num_players > 16) usage(argv[0]);
+        } else if (strcmp(argv[i], "--projectiles") == 0 && i + 1 < argc) {
+            config.num_projectiles = atoi(argv[++i]);
+            if (config.num_projectiles < 0 || config.num_projectiles > 63) usage(argv[0]);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            config.frames = atoi(argv[++i]);
+            if (config.frames < 1) usage(argv[0]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            config.threads = atoi(argv[++i]);
+            if (config.threads < 1 || config.threads > RASTER_MAX_THREADS) usage(argv[0]);
+        } else if (strcmp(argv[i], "--half-block") == 0) {
+            config.half_block = 1;
+        } else if (strcmp(argv[i], "--colors") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "truecolor") == 0) config.color_mode = COLOR_MODE_TRUECOLOR;
+            else if (strcmp(argv[i], "256") == 0) config.color_mode = COLOR_MODE_256;
+            else if (strcmp(argv[i], "16") == 0) config.color_mode = COLOR_MODE_16;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--run-encoding") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "none") == 0) config.run_encoding = RUN_ENCODING_NONE;
+            else if (strcmp(argv[i], "erase") == 0) config.run_encoding = RUN_ENCODING_ERASE;
+            else if (strcmp(argv[i], "repeat") == 0) config.run_encoding = RUN_ENCODING_REPEAT;
+            else usage(argv[0]);
+        } else if (strcmp(argv[i], "--scenes-only") == 0) {
+            run_lines = 0;
+        } else if (strcmp(argv[i], "--lines-only") == 0) {
+            run_scenes = 0;
+        } else {
+            usage(argv[0]);
+        }
+    }
+
+    if (run_scenes) bench_scenes(&config);
+    if (run_lines) bench_wu_lines();
+    return 0;
+}
@@ -1,4 +1,5 @@
 #!/bin/bash
 gcc -o gameserver gameserver.c game.c -lm
 gcc -o gameclient gameclient.c game.c -lm
+gcc -O2 -o bench bench.c game.c -lm
 echo "Build complete"
@@ -9,14 +9,123 @@ Camera playerCamera = {
 };
 FrameBuffer screen;
 FrameBuffer antiAliased;
-char frameString[7 + HEIGHT * WIDTH * (21) + HEIGHT + 1 + 4];
+char *frameString;
 unsigned long frameStringSize;
+unsigned long droppedFrames = 0;
 short activeMSAA = 1;
+short hiddenEdgeRemoval = 0;    // Skip cuboid edges whose two faces both face away
+short activePostProcess = POST_PROCESS_NONE;
+short halfBlockMode = 0;        // Two framebuffer rows per cell, drawn with '▀'
+short activeColorMode = COLOR_MODE_TRUECOLOR;
+short activeRunEncoding = RUN_ENCODING_NONE;
+int outputColumns = WIDTH;      // Output size in terminal cells
+int outputRows = HEIGHT;
+static int rowsPerCell = 1;
+static short frameNeedsReset = 1;
+// Camera and projection terms shared by every line drawn in a frame;
+// recomputed only when the camera moves or turns
+typedef struct {
+    Vec3 position;
+    double cosYaw, sinYaw;      // Camera yaw, for rotating world into view space
+    double centerX, centerY;    // Screen position of the view axis
+    double scaleX, scaleY;      // Pixels per unit of x/z and y/z
+    double tanHalfX, tanHalfY;  // Frustum side planes: |x| <= z * tanHalfX, |y| <= z * tanHalfY
+    double normX, normY;        // 1 / length of those planes' normals
+    short ready;
+} ViewTransform;
+
+static ViewTransform view;
+
+// A view-space vertex with its screen position (valid when view.z > 0)
+typedef struct {
+    Vec3 view;
+    double sx, sy;
+} ProjectedVertex;
+
+// Batched transform of every player's vertices in a frame. Vertices are
+// stored as structure-of-arrays so model->view->screen runs four at a time
+// with vector types; edges index into the shared, already-transformed corners.
+#define BATCH_MAX_VERTICES (16 * (3 * 8 + 2))   // Per player: body + 2 ears + gun
+#define BATCH_MAX_EDGES (16 * (3 * 12 + 1))
+#define BATCH_ALIGN __attribute__((aligned(32)))
+
+typedef double v4d __attribute__((vector_size(32)));
+
+typedef struct {
+    // Model space corner, and the rotation/position of the object it belongs to
+    double lx[BATCH_MAX_VERTICES] BATCH_ALIGN, ly[BATCH_MAX_VERTICES] BATCH_ALIGN, lz[BATCH_MAX_VERTICES] BATCH_ALIGN;
+    double sinR[BATCH_MAX_VERTICES] BATCH_ALIGN, cosR[BATCH_MAX_VERTICES] BATCH_ALIGN;
+    double px[BATCH_MAX_VERTICES] BATCH_ALIGN, py[BATCH_MAX_VERTICES] BATCH_ALIGN, pz[BATCH_MAX_VERTICES] BATCH_ALIGN;
+    // View space and screen results
+    double vx[BATCH_MAX_VERTICES] BATCH_ALIGN, vy[BATCH_MAX_VERTICES] BATCH_ALIGN, vz[BATCH_MAX_VERTICES] BATCH_ALIGN;
+    double sx[BATCH_MAX_VERTICES] BATCH_ALIGN, sy[BATCH_MAX_VERTICES] BATCH_ALIGN;
+    int vertexCount;
+    struct {
+        short v0, v1;
+        Color color;
+        short cuboid;           // First vertex of the owning cuboid, -1 if none
+        unsigned char faces;    // Adjacent faces (low/high nibble) of that cuboid
+    } edges[BATCH_MAX_EDGES];
+    int edgeCount;
+    // Bitmask of camera-facing faces, indexed by a cuboid's first vertex
+    unsigned char facing[BATCH_MAX_VERTICES];
+    short cuboids[BATCH_MAX_VERTICES / 8];
+    int cuboidCount;
+} VertexBatch;
+
+static VertexBatch batch;
+
+// Band-parallel rendering: band b owns screen rows [bandTop(b), bandTop(b + 1))
+// and is processed by worker b (band 0 by the caller), so workers never
+// touch the same z-buffer or color cells
+static int rasterThreadCount = 1;
+static int rasterWorkersStarted = 1;
+static pthread_t rasterWorkers[RASTER_MAX_THREADS];
+static pthread_mutex_t rasterMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t rasterStart = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t rasterDone = PTHREAD_COND_INITIALIZER;
+static unsigned int rasterGeneration = 0;
+static int rasterPending = 0;
+static void (*rasterJob)(int band);
+static short bandEdges[RASTER_MAX_THREADS][BATCH_MAX_EDGES];
+static int bandEdgeCount[RASTER_MAX_THREADS];
+
+static const int cuboidEdges[12][2] = {
+    {0,1},{1,2},{2,3},{3,0},
+    {4,5},{5,6},{6,7},{7,4},
+    {0,4},{1,5},{2,6},{3,7}
+};
+
+// Cuboid faces -x, +x, -y, +y, -z, +z by corner, and the two faces each edge joins
+static const int cuboidFaces[6][4] = {
+    {0,3,7,4}, {1,2,6,5},
+    {0,1,5,4}, {3,2,6,7},
+    {0,1,2,3}, {4,5,6,7}
+};
+static const unsigned char cuboidEdgeFaces[12] = {
+    0x42, 0x41, 0x43, 0x40,
+    0x52, 0x51, 0x53, 0x50,
+    0x20, 0x21, 0x31, 0x30
+};
+
+// What the terminal currently shows, per framebuffer pixel, so only changed
+// cells are emitted
+static char *shownPixels;
+static Color *shownColor;
+static short shownValid = 0;
 
 void setActiveMSAA(short activate){
     activeMSAA = activate;
 }
 
+void setHiddenEdgeRemoval(short activate){
+    hiddenEdgeRemoval = activate;
+}
+
+void setPostProcess(short mode){
+    activePostProcess = mode;
+}
+
 void initProjectileQueue(ProjectileQueue *queue) {
     queue->head = 0;
     queue->tail = 0;
@@ -133,50 +242,164 @@ Color blend(Color dst, Color src, float a) {
     out.red   = dst.red   + (int)((src.red   - dst.red)   * a);
     out.green = dst.green + (int)((src.green - dst.green) * a);
     out.blue  = dst.blue  + (int)((src.blue  - dst.blue)  * a);
+    out.pad   = 0;
     return out;
 }
 
-void drawLineZ_Wu(
-    Vec3 c0, Vec3 c1,
-    int width, int height, Color lineColor,
-    FrameBuffer *frame
-) {
-    // Adjust for camera
-    c0.x -= playerCamera.position.x;
-    c0.y -= playerCamera.position.y;
-    c0.z -= playerCamera.position.z;
+static void updateView(void) {
+    double fov_rad = FOV * PI / 180.0;
+    double fov_scale = 1.0 / tan(fov_rad / 2.0);
+    // Cells are square on screen; framebuffer rows are 1/rowsPerCell of a cell
+    double aspect = (double)screen.width / outputRows;
+
+    view.position = playerCamera.position;
+    view.cosYaw = cos(playerCamera.yaw);
+    view.sinYaw = sin(playerCamera.yaw);
+    view.centerX = screen.width / 2;
+    view.centerY = screen.height / 2;
+    view.scaleX = fov_scale * (screen.width / 2);
+    view.scaleY = fov_scale * aspect * (screen.height / 2);
+    view.tanHalfX = view.centerX / view.scaleX;
+    view.tanHalfY = view.centerY / view.scaleY;
+    view.normX = 1.0 / sqrt(1.0 + view.tanHalfX * view.tanHalfX);
+    view.normY = 1.0 / sqrt(1.0 + view.tanHalfY * view.tanHalfY);
+    view.ready = 1;
+}
+
+// World space to camera space: translate, then rotate by -yaw around Y
+static inline Vec3 worldToView(Vec3 p) {
+    double x = p.x - view.position.x;
+    double z = p.z - view.position.z;
+    Vec3 result;
+    result.x = x * view.cosYaw - z * view.sinYaw;
+    result.y = p.y - view.position.y;
+    result.z = z * view.cosYaw + x * view.sinYaw;
+    return result;
+}
+
+// Conservative test of a world-space bounding sphere against the view
+// frustum (near and side planes). Returns 0 only if it is entirely outside.
+static int sphereInFrustum(Vec3 center, double radius) {
+    if (!view.ready) updateView();
+    Vec3 c = worldToView(center);
+    if (c.z + radius < NEAR_PLANE) return 0;
+    if ((fabs(c.x) - c.z * view.tanHalfX) * view.normX > radius) return 0;
+    if ((fabs(c.y) - c.z * view.tanHalfY) * view.normY > radius) return 0;
+    return 1;
+}
 
-    c0 = rotateY(c0, -playerCamera.yaw);
+static inline ProjectedVertex projectVertex(Vec3 v) {
+    ProjectedVertex p;
+    p.view = v;
+    p.sx = (v.x / v.z) * view.scaleX + view.centerX;
+    p.sy = -(v.y / v.z) * view.scaleY + view.centerY;
+    return p;
+}
 
-    c1.x -= playerCamera.position.x;
-    c1.y -= playerCamera.position.y;
-    c1.z -= playerCamera.position.z;
+// Clip a segment to the near plane in view space, reprojecting any endpoint
+// that moved. Returns 0 if nothing is in front of the plane.
+static int clipNear(ProjectedVertex *v0, ProjectedVertex *v1) {
+    double z0 = v0->view.z;
+    double z1 = v1->view.z;
+    if (z0 < NEAR_PLANE && z1 < NEAR_PLANE) return 0;
+    if (z0 >= NEAR_PLANE && z1 >= NEAR_PLANE) return 1;
+
+    double t = (NEAR_PLANE - z0) / (z1 - z0);
+    Vec3 hit = {
+        v0->view.x + t * (v1->view.x - v0->view.x),
+        v0->view.y + t * (v1->view.y - v0->view.y),
+        NEAR_PLANE
+    };
+    if (z0 < NEAR_PLANE) *v0 = projectVertex(hit);
+    else *v1 = projectVertex(hit);
+    return 1;
+}
 
-    c1 = rotateY(c1, -playerCamera.yaw);
+// Screen-space segment with depth interpolated linearly along it
+typedef struct {
+    double x0, y0, z0;
+    double x1, y1, z1;
+} ScreenSegment;
+
+// Liang-Barsky clip of a segment to [xMin, xMax] x [yMin, yMax].
+// Returns 0 if the segment misses the rectangle.
+static int clipToRect(ScreenSegment *s, double xMin, double yMin, double xMax, double yMax) {
+    double dx = s->x1 - s->x0;
+    double dy = s->y1 - s->y0;
+    double p[4] = {-dx, dx, -dy, dy};
+    double q[4] = {s->x0 - xMin, xMax - s->x0, s->y0 - yMin, yMax - s->y0};
+    double t0 = 0.0, t1 = 1.0;
+
+    for (int i = 0; i < 4; i++) {
+        if (p[i] == 0) {
+            if (q[i] < 0) return 0;     // Parallel to and outside this edge
+            continue;
+        }
+        double r = q[i] / p[i];
+        if (p[i] < 0) {
+            if (r > t1) return 0;
+            if (r > t0) t0 = r;
+        } else {
+            if (r < t0) return 0;
+            if (r < t1) t1 = r;
+        }
+    }
 
-    // Skip if both points are behind camera
-    if (c0.z <= 0 && c1.z <= 0) return;     
-    
-    double fov_rad = FOV * PI / 180.0;
-    double fov_scale = 1.0 / tan(fov_rad / 2.0);
-    double aspect = (double)WIDTH / HEIGHT;
+    ScreenSegment in = *s;
+    double dz = in.z1 - in.z0;
+    s->x0 = in.x0 + t0 * dx;
+    s->y0 = in.y0 + t0 * dy;
+    s->z0 = in.z0 + t0 * dz;
+    s->x1 = in.x0 + t1 * dx;
+    s->y1 = in.y0 + t1 * dy;
+    s->z1 = in.z0 + t1 * dz;
+    return 1;
+}
+
+// Wu coverage in 16.16 fixed point
+#define WU_FRAC_BITS 16
+#define WU_ONE (1 << WU_FRAC_BITS)
 
-    float scaledX0 = c0.x == 0.0? 0.0 : (c0.x / fabs(c0.z));
-    float scaledY0 = c0.y == 0.0? 0.0 : (c0.y / fabs(c0.z));
-    float scaledX1 = c1.x == 0.0? 0.0 : (c1.x / fabs(c1.z));
-    float scaledY1 = c1.y == 0.0? 0.0 : (c1.y / fabs(c1.z));
+// blend() with coverage a in [0, WU_ONE]; truncates toward zero like blend()
+static inline Color blendFixed(Color dst, Color src, int a) {
+    Color out;
+    out.red   = dst.red   + (src.red   - dst.red)   * a / WU_ONE;
+    out.green = dst.green + (src.green - dst.green) * a / WU_ONE;
+    out.blue  = dst.blue  + (src.blue  - dst.blue)  * a / WU_ONE;
+    out.pad   = 0;
+    return out;
+}
+
+// Grow the row's dirty span to include column x
+static inline void markDirty(FrameBuffer *frame, int x, int y) {
+    if (x < frame->dirtyMinX[y]) frame->dirtyMinX[y] = x;
+    if (x > frame->dirtyMaxX[y]) frame->dirtyMaxX[y] = x;
+}
+
+// Floating-point Wu line, kept as the reference for rasterLineZ_Wu
+static void rasterLineZ_WuFloat(
+    const ProjectedVertex *v0, const ProjectedVertex *v1,
+    int width, int yMin, int yMax, Color lineColor,
+    FrameBuffer *frame
+) {
+    ProjectedVertex a = *v0;
+    ProjectedVertex b = *v1;
+    if (!clipNear(&a, &b)) return;
 
-    float px0 = (scaledX0) * fov_scale * (WIDTH / 2) + WIDTH / 2;
-    float py0 = -(scaledY0) * fov_scale * aspect * (HEIGHT / 2) + HEIGHT / 2;
-    float px1 = (scaledX1) * fov_scale  * (WIDTH / 2) + WIDTH / 2;
-    float py1 = -(scaledY1) * fov_scale * aspect * (HEIGHT / 2) + HEIGHT / 2;
+    // One pixel of margin so coverage on the border rows/columns is kept
+    ScreenSegment seg = {a.sx, a.sy, a.view.z, b.sx, b.sy, b.view.z};
+    if (!clipToRect(&seg, -1.0, yMin - 1.0, width, yMax)) return;
 
-    float z0 = c0.z;
-    float z1 = c1.z;
+    float px0 = seg.x0;
+    float py0 = seg.y0;
+    float px1 = seg.x1;
+    float py1 = seg.y1;
+    float z0 = seg.z0;
+    float z1 = seg.z1;
 
-    char  (*screen)[WIDTH]  = frame->pixels;
-    float (*zbuffer)[WIDTH] = frame->zbuffer;
-    Color (*color)[WIDTH]   = frame->color;
+    char  (*screen)[frame->width]  = FRAME_PIXELS(frame);
+    float (*zbuffer)[frame->width] = FRAME_ZBUFFER(frame);
+    Color (*color)[frame->width]   = FRAME_COLOR(frame);
 
     int steep = fabs(py1 - py0) > fabs(px1 - px0);
     if (steep) {
@@ -195,24 +418,11 @@ void drawLineZ_Wu(
     float dy = py1 - py0;
     float gradient = (dx == 0) ? 0 : dy / dx;
 
-    // Handle infinity when casting to int
-    int xStart, xEnd;
-    if (isinf(px0) && px0 < 0) xStart = INT_MIN;
-    else if (isinf(px0) && px0 > 0) xStart = INT_MAX;
-    else xStart = (int)ceilf(px0);
-    
-    if (isinf(px1) && px1 < 0) xEnd = INT_MIN;
-    else if (isinf(px1) && px1 > 0) xEnd = INT_MAX;
-    else xEnd = (int)floorf(px1);
-
-    if(xStart < 0) xStart = 0;
-    if(xStart > (steep ? height : width)) xStart = (steep ? height : width);
-    if(xEnd < 0) xEnd = 0;
-    if(xEnd > (steep ? height : width)) xEnd = (steep ? height : width);
+    int xStart = (int)ceilf(px0);
+    int xEnd = (int)floorf(px1);
     for (int x = xStart; x <= xEnd; x++) {
         float t = (dx == 0) ? 0.0f : (x - px0) / dx;
         float z = z0 + t * (z1 - z0);
-        if (z <= 0.0f) continue;
 
         float y = py0 + gradient * (x - px0);
         int yInt = (int)floorf(y);
@@ -225,67 +435,144 @@ void drawLineZ_Wu(
             int sx = steep ? yy : x;
             int sy = steep ? x  : yy;
 
-            if (sx < 0 || sx >= width || sy < 0 || sy >= height)
+            if (sx < 0 || sx >= width || sy < yMin || sy >= yMax)
                 continue;
 
             if (z < zbuffer[sy][sx]) {
                 color[sy][sx] = blend(color[sy][sx], lineColor, a);
                 zbuffer[sy][sx] = z;
                 screen[sy][sx] = ' ';
+                markDirty(frame, sx, sy);
             }
         }
     }
 }
 
 
-
-void drawLineZ(
-    Vec3 c0, Vec3 c1,
-    int width, int height, Color lineColor,
-    FrameBuffer * frame
+// Antialiased line between two projected view-space points, drawn only into
+// rows [yMin, yMax). Fixed-point version of rasterLineZ_WuFloat: y steps by a
+// 16.16 gradient and coverage blends in integers. Endpoints are clipped to the
+// whole screen, not the band, so every band steps from the same start.
+static void rasterLineZ_Wu(
+    const ProjectedVertex *v0, const ProjectedVertex *v1,
+    int width, int height, int yMin, int yMax, Color lineColor,
+    FrameBuffer *frame
 ) {
-    // Adjust for camera
-    c0.x -= playerCamera.position.x;
-    c0.y -= playerCamera.position.y;
-    c0.z -= playerCamera.position.z;
+    ProjectedVertex a = *v0;
+    ProjectedVertex b = *v1;
+    if (!clipNear(&a, &b)) return;
 
-    c0 = rotateY(c0, -playerCamera.yaw);
+    // One pixel of margin so coverage on the border rows/columns is kept
+    ScreenSegment seg = {a.sx, a.sy, a.view.z, b.sx, b.sy, b.view.z};
+    if (!clipToRect(&seg, -1.0, -1.0, width, height)) return;
 
-    c1.x -= playerCamera.position.x;
-    c1.y -= playerCamera.position.y;
-    c1.z -= playerCamera.position.z;
+    float px0 = seg.x0;
+    float py0 = seg.y0;
+    float px1 = seg.x1;
+    float py1 = seg.y1;
+    float z0 = seg.z0;
+    float z1 = seg.z1;
 
-    c1 = rotateY(c1, -playerCamera.yaw);
+    char  (*screen)[frame->width]  = FRAME_PIXELS(frame);
+    float (*zbuffer)[frame->width] = FRAME_ZBUFFER(frame);
+    Color (*color)[frame->width]   = FRAME_COLOR(frame);
 
-    // Skip if both points are behind camera
-    if (c0.z <= 0 && c1.z <= 0) return;
+    int steep = fabs(py1 - py0) > fabs(px1 - px0);
+    if (steep) {
+        float t;
+        t = px0; px0 = py0; py0 = t;
+        t = px1; px1 = py1; py1 = t;
+    }
+    if (px0 > px1) {
+        float t;
+        t = px0; px0 = px1; px1 = t;
+        t = py0; py0 = py1; py1 = t;
+        t = z0;  z0  = z1;  z1  = t;
+    }
 
-    // Projection parameters
-    double fov_rad = FOV * PI / 180.0;
-    double fov_scale = 1.0 / tan(fov_rad / 2.0);
-    double aspect = (double)WIDTH / HEIGHT;
-
-    // Proper perspective projection with FOV
-    int x0 = (int)((c0.x / c0.z) * fov_scale * (WIDTH / 2) + WIDTH / 2);
-    int y0 = (int)(-(c0.y / c0.z) * fov_scale * aspect * (HEIGHT / 2) + HEIGHT / 2);
-    int x1 = (int)((c1.x / c1.z) * fov_scale * (WIDTH / 2) + WIDTH / 2);
-    int y1 = (int)(-(c1.y / c1.z) * fov_scale * aspect * (HEIGHT / 2) + HEIGHT / 2);
-    float z0 = c0.z;
-    float z1 = c1.z;
-
-    // Clamp to reasonable bounds to prevent infinite loops on extreme values
-    if (x0 < -width) x0 = -width;
-    if (x0 > width * 2) x0 = width * 2;
-    if (y0 < -height) y0 = -height;
-    if (y0 > height * 2) y0 = height * 2;
-    if (x1 < -width) x1 = -width;
-    if (x1 > width * 2) x1 = width * 2;
-    if (y1 < -height) y1 = -height;
-    if (y1 > height * 2) y1 = height * 2;
-
-    char (*screen)[WIDTH] = frame->pixels;
-    float (*zbuffer)[WIDTH] = frame->zbuffer;
-    Color (*color)[WIDTH] = frame->color;
+    float dx = px1 - px0;
+    float invDx = (dx == 0) ? 0.0f : 1.0f / dx;
+    float gradient = (py1 - py0) * invDx;
+    float dzdx = (z1 - z0) * invDx;
+
+    int xStart = (int)ceilf(px0);
+    int xEnd = (int)floorf(px1);
+    int32_t yFix = (int32_t)lrintf((py0 + gradient * (xStart - px0)) * WU_ONE);
+    int32_t gradientFix = (int32_t)lrintf(gradient * WU_ONE);
+
+    // Narrow the major axis to the part that can touch rows [yMin, yMax)
+    int first = xStart;
+    int last = xEnd;
+    if (steep) {
+        if (first < yMin) first = yMin;
+        if (last > yMax - 1) last = yMax - 1;
+    } else if (yMin > 0 || yMax < height) {
+        if (gradient == 0) {
+            int row = yFix >> WU_FRAC_BITS;
+            if (row + 1 < yMin || row >= yMax) return;
+        } else {
+            // Two columns of slack for fixed-point drift; the per-pixel test is exact
+            float xa = px0 + ((yMin - 1) - py0) / gradient;
+            float xb = px0 + (yMax - py0) / gradient;
+            first = (int)fmaxf(first, floorf(fminf(xa, xb)) - 2);
+            last = (int)fminf(last, ceilf(fmaxf(xa, xb)) + 2);
+        }
+    }
+    if (first > last) return;
+    yFix += (first - xStart) * gradientFix;
+
+    for (int x = first; x <= last; x++, yFix += gradientFix) {
+        float z = z0 + (x - px0) * dzdx;
+        int yInt = yFix >> WU_FRAC_BITS;
+        int cover = yFix & (WU_ONE - 1);    // Coverage of row yInt + 1
+
+        for (int k = 0; k < 2; k++) {
+            int yy = yInt + k;
+            int a = (k == 0) ? (WU_ONE - cover) : cover;
+
+            int sx = steep ? yy : x;
+            int sy = steep ? x  : yy;
+
+            if (sx < 0 || sx >= width || sy < yMin || sy >= yMax)
+                continue;
+
+            if (z < zbuffer[sy][sx]) {
+                color[sy][sx] = blendFixed(color[sy][sx], lineColor, a);
+                zbuffer[sy][sx] = z;
+                screen[sy][sx] = ' ';
+                markDirty(frame, sx, sy);
+            }
+        }
+    }
+}
+
+// Line between two projected view-space points, drawn only into rows [yMin, yMax).
+// Endpoints are clipped to the whole screen, not the band, so a line split
+// across bands steps through exactly the same pixels as an unsplit one.
+static void rasterLineZ(
+    const ProjectedVertex *v0, const ProjectedVertex *v1,
+    int width, int height, int yMin, int yMax, Color lineColor,
+    FrameBuffer * frame
+) {
+    ProjectedVertex a = *v0;
+    ProjectedVertex b = *v1;
+    if (!clipNear(&a, &b)) return;
+
+    // Clipped endpoints are on screen, so every step below is a visible pixel
+    ScreenSegment seg = {a.sx, a.sy, a.view.z, b.sx, b.sy, b.view.z};
+    if (!clipToRect(&seg, 0.0, 0.0, width - 1, height - 1)) return;
+
+    int x0 = (int)seg.x0;
+    int y0 = (int)seg.y0;
+    int x1 = (int)seg.x1;
+    int y1 = (int)seg.y1;
+    if ((y0 < yMin && y1 < yMin) || (y0 >= yMax && y1 >= yMax)) return;
+    float z0 = seg.z0;
+    float z1 = seg.z1;
+
+    char (*screen)[frame->width] = FRAME_PIXELS(frame);
+    float (*zbuffer)[frame->width] = FRAME_ZBUFFER(frame);
+    Color (*color)[frame->width] = FRAME_COLOR(frame);
 
     int dx = abs(x1 - x0);
     int dy = abs(y1 - y0);
@@ -304,30 +591,16 @@ void drawLineZ(
         float t = (steps == 0) ? 0.0f : (float)step / steps;
         float z = z0 + t * (z1 - z0);
 
-        // Skip if behind camera
-        if (z <= 0.5) {
-            if (x == x1 && y == y1)
-                break;
-            int e2 = 2 * err;
-            if (e2 > -dy) {
-                err -= dy;
-                x += sx;
-            }
-            if (e2 < dx) {
-                err += dx;
-                y += sy;
-            }
-            step++;
-            continue;
-        }
-
-        // Draw pixel if it's in bounds and closer than current zbuffer
-        if (x >= 0 && x < width && y >= 0 && y < height) {
-            if (z < zbuffer[y][x] && z > 0) {
+        // Draw pixel if it's in the band and closer than current zbuffer
+        if (y >= yMin && y < yMax) {
+            if (z < zbuffer[y][x]) {
                 screen[y][x] = ' ';      // or whatever pixel value
                 zbuffer[y][x] = z;       // update depth
                 color[y][x] = lineColor; // update color
+                markDirty(frame, x, y);
             }
+        } else if ((sy > 0) == (y >= yMax)) {
+            break;                       // Left the band for good
         }
 
         if (x == x1 && y == y1)
@@ -347,138 +620,408 @@ void drawLineZ(
     }
 }
 
-void drawCuboid(const Cuboid cuboid) {
-    // Generate corner vectors
-    Vec3 corners[8];
-    double hw = cuboid.width / 2.0; // half width
-    double hh = cuboid.height / 2.0; // half height
-    double hd = cuboid.depth / 2.0; // half depth
-    corners[0] = (Vec3){-hw, -hh , -hd };
-    corners[1] = (Vec3){ hw, -hh , -hd };
-    corners[2] = (Vec3){ hw,  hh , -hd };
-    corners[3] = (Vec3){-hw,  hh , -hd };
-    corners[4] = (Vec3){-hw, -hh ,  hd };
-    corners[5] = (Vec3){ hw, -hh ,  hd };
-    corners[6] = (Vec3){ hw,  hh ,  hd };
-    corners[7] = (Vec3){-hw,  hh ,  hd };
-
-    for(int i = 0; i < 8; i++) {
-        corners[i] = rotateY(corners[i], cuboid.rotation_y);
-    }
-    for(int i = 0; i < 8; i++) {
-        corners[i].x += cuboid.position.x;
-        corners[i].y += cuboid.position.y;
-        corners[i].z += cuboid.position.z;
+void drawLineZ_Wu(
+    Vec3 c0, Vec3 c1,
+    int width, int height, Color lineColor,
+    FrameBuffer *frame
+) {
+    if (!view.ready) updateView();
+    ProjectedVertex v0 = projectVertex(worldToView(c0));
+    ProjectedVertex v1 = projectVertex(worldToView(c1));
+    rasterLineZ_Wu(&v0, &v1, width, height, 0, height, lineColor, frame);
+}
+
+void drawLineZ_WuFloat(
+    Vec3 c0, Vec3 c1,
+    int width, int height, Color lineColor,
+    FrameBuffer *frame
+) {
+    if (!view.ready) updateView();
+    ProjectedVertex v0 = projectVertex(worldToView(c0));
+    ProjectedVertex v1 = projectVertex(worldToView(c1));
+    rasterLineZ_WuFloat(&v0, &v1, width, 0, height, lineColor, frame);
+}
+
+void drawLineZ(
+    Vec3 c0, Vec3 c1,
+    int width, int height, Color lineColor,
+    FrameBuffer * frame
+) {
+    if (!view.ready) updateView();
+    ProjectedVertex v0 = projectVertex(worldToView(c0));
+    ProjectedVertex v1 = projectVertex(worldToView(c1));
+    rasterLineZ(&v0, &v1, width, height, 0, height, lineColor, frame);
+}
+
+// Draw a line between two projected vertices with the active rasterizer
+static void drawProjectedLine(const ProjectedVertex *v0, const ProjectedVertex *v1, Color lineColor) {
+    if(activeMSAA)
+        rasterLineZ_Wu(v0, v1, screen.width, screen.height, 0, screen.height, lineColor, &screen);
+    else
+        rasterLineZ(v0, v1, screen.width, screen.height, 0, screen.height, lineColor, &screen);
+}
+
+static void batchReset(void) {
+    batch.vertexCount = 0;
+    batch.edgeCount = 0;
+    batch.cuboidCount = 0;
+}
+
+static void batchAddVertex(Vec3 local, double s, double c, Vec3 position) {
+    int i = batch.vertexCount++;
+    batch.lx[i] = local.x;
+    batch.ly[i] = local.y;
+    batch.lz[i] = local.z;
+    batch.sinR[i] = s;
+    batch.cosR[i] = c;
+    batch.px[i] = position.x;
+    batch.py[i] = position.y;
+    batch.pz[i] = position.z;
+}
+
+static void batchAddEdge(int v0, int v1, Color color, int cuboid, unsigned char faces) {
+    int i = batch.edgeCount++;
+    batch.edges[i].v0 = v0;
+    batch.edges[i].v1 = v1;
+    batch.edges[i].color = color;
+    batch.edges[i].cuboid = cuboid;
+    batch.edges[i].faces = faces;
+}
+
+// Queue a cuboid's 8 corners and 12 edges, with one sin/cos per cuboid
+static void batchAddCuboid(const Cuboid *cuboid) {
+    double hw = cuboid->width / 2.0; // half width
+    double hh = cuboid->height / 2.0; // half height
+    double hd = cuboid->depth / 2.0; // half depth
+    double s = sin(cuboid->rotation_y);
+    double c = cos(cuboid->rotation_y);
+    int base = batch.vertexCount;
+    batchAddVertex((Vec3){-hw, -hh, -hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){ hw, -hh, -hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){ hw,  hh, -hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){-hw,  hh, -hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){-hw, -hh,  hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){ hw, -hh,  hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){ hw,  hh,  hd}, s, c, cuboid->position);
+    batchAddVertex((Vec3){-hw,  hh,  hd}, s, c, cuboid->position);
+    for(int i = 0; i < 12; i++) {
+        batchAddEdge(base + cuboidEdges[i][0], base + cuboidEdges[i][1], cuboid->color, base, cuboidEdgeFaces[i]);
     }
-    
-    // Draw edges
-    int edges[12][2] = {
-        {0,1},{1,2},{2,3},{3,0},
-        {4,5},{5,6},{6,7},{7,4},
-        {0,4},{1,5},{2,6},{3,7}
+    batch.cuboids[batch.cuboidCount++] = base;
+}
+
+// A gun is a line from its position along its local +z axis
+static void batchAddGun(const Gun *gun) {
+    double s = sin(gun->rotation_y);
+    double c = cos(gun->rotation_y);
+    int base = batch.vertexCount;
+    batchAddVertex((Vec3){0, 0, 0}, s, c, gun->position);
+    batchAddVertex((Vec3){0, 0, gun->length}, s, c, gun->position);
+    batchAddEdge(base, base + 1, gun->color, -1, 0);
+}
+
+// The two small cuboids on top of a player's body
+static void playerEars(const Player *player, Cuboid ears[2]) {
+    double offsetX = player->cuboid.width * 0.25;
+    double offsetY = player->cuboid.height * 0.25;
+    double smallSize = player->cuboid.width * 0.2;
+
+    // Top left, then top right (in local space before rotation)
+    Vec3 locals[2] = {
+        {-offsetX, offsetY, 0},
+        { offsetX, offsetY, 0}
     };
-    for(int i = 0; i < 12; i++) {
-        Vec3 c0 = corners[edges[i][0]];
-        Vec3 c1 = corners[edges[i][1]];
+    for(int i = 0; i < 2; i++) {
+        Vec3 rotated = rotateY(locals[i], player->cuboid.rotation_y);
+        ears[i] = (Cuboid){
+            .position = {
+                player->cuboid.position.x + rotated.x,
+                player->cuboid.position.y + rotated.y,
+                player->cuboid.position.z + rotated.z
+            },
+            .width = smallSize,
+            .height = smallSize,
+            .depth = smallSize,
+            .rotation_y = player->cuboid.rotation_y,
+            .color = player->cuboid.color
+        };
+    }
+}
+
+// Sphere around the body, both ears and the gun
+static int playerVisible(const Player *player) {
+    const Cuboid *body = &player->cuboid;
+    double hw = body->width / 2.0;
+    double hh = body->height / 2.0;
+    double hd = body->depth / 2.0;
+    double radius = sqrt(hw * hw + hh * hh + hd * hd);
+
+    // Ear corners reach 0.35w sideways and 0.25h + 0.1w up from the center
+    double earX = body->width * 0.35;
+    double earY = body->height * 0.25 + body->width * 0.1;
+    double earZ = body->width * 0.1;
+    double earReach = sqrt(earX * earX + earY * earY + earZ * earZ);
+    if (earReach > radius) radius = earReach;
+
+    double gx = player->gun.position.x - body->position.x;
+    double gy = player->gun.position.y - body->position.y;
+    double gz = player->gun.position.z - body->position.z;
+    double gunReach = sqrt(gx * gx + gy * gy + gz * gz) + fabs(player->gun.length);
+    if (gunReach > radius) radius = gunReach;
+
+    return sphereInFrustum(body->position, radius);
+}
+
+static void batchAddPlayer(const Player *player) {
+    Cuboid ears[2];
+    playerEars(player, ears);
+    batchAddCuboid(&player->cuboid);
+    batchAddGun(&player->gun);
+    batchAddCuboid(&ears[0]);
+    batchAddCuboid(&ears[1]);
+}
+
+// Model -> world -> view -> screen for every queued vertex, four at a time.
+// The tail is padded to a whole vector; padded lanes are never referenced.
+static void transformBatch(void) {
+    if (!view.ready) updateView();
+
+    int count = (batch.vertexCount + 3) & ~3;
+    for(int i = batch.vertexCount; i < count; i++) {
+        batch.lx[i] = batch.ly[i] = batch.lz[i] = 0.0;
+        batch.sinR[i] = batch.cosR[i] = 0.0;
+        batch.px[i] = batch.py[i] = batch.pz[i] = 0.0;
+    }
+
+    v4d camX = {view.position.x, view.position.x, view.position.x, view.position.x};
+    v4d camY = {view.position.y, view.position.y, view.position.y, view.position.y};
+    v4d camZ = {view.position.z, view.position.z, view.position.z, view.position.z};
+    v4d cosYaw = {view.cosYaw, view.cosYaw, view.cosYaw, view.cosYaw};
+    v4d sinYaw = {view.sinYaw, view.sinYaw, view.sinYaw, view.sinYaw};
+    v4d scaleX = {view.scaleX, view.scaleX, view.scaleX, view.scaleX};
+    v4d scaleY = {view.scaleY, view.scaleY, view.scaleY, view.scaleY};
+    v4d halfW = {view.centerX, view.centerX, view.centerX, view.centerX};
+    v4d halfH = {view.centerY, view.centerY, view.centerY, view.centerY};
+
+    for(int i = 0; i < count; i += 4) {
+        v4d lx = *(v4d *)&batch.lx[i];
+        v4d ly = *(v4d *)&batch.ly[i];
+        v4d lz = *(v4d *)&batch.lz[i];
+        v4d s = *(v4d *)&batch.sinR[i];
+        v4d c = *(v4d *)&batch.cosR[i];
+
+        // Model to world, relative to the camera
+        v4d x = lz * s + lx * c + *(v4d *)&batch.px[i] - camX;
+        v4d y = ly + *(v4d *)&batch.py[i] - camY;
+        v4d z = lz * c - lx * s + *(v4d *)&batch.pz[i] - camZ;
+
+        // World to view
+        v4d vx = x * cosYaw - z * sinYaw;
+        v4d vz = z * cosYaw + x * sinYaw;
+        *(v4d *)&batch.vx[i] = vx;
+        *(v4d *)&batch.vy[i] = y;
+        *(v4d *)&batch.vz[i] = vz;
+
+        // View to screen; lanes behind the camera are not used as-is
+        *(v4d *)&batch.sx[i] = (vx / vz) * scaleX + halfW;
+        *(v4d *)&batch.sy[i] = -(y / vz) * scaleY + halfH;
+    }
+}
+
+// A face is towards the camera (the view-space origin) when its outward
+// normal, the direction from the cuboid's center to the face's center,
+// points against the face's position
+static void computeFacing(void) {
+    for(int k = 0; k < batch.cuboidCount; k++) {
+        int base = batch.cuboids[k];
+        double cx = 0, cy = 0, cz = 0;
+        for(int i = 0; i < 8; i++) {
+            cx += batch.vx[base + i];
+            cy += batch.vy[base + i];
+            cz += batch.vz[base + i];
+        }
+        cx /= 8; cy /= 8; cz /= 8;
+
+        unsigned char mask = 0;
+        for(int f = 0; f < 6; f++) {
+            double fx = 0, fy = 0, fz = 0;
+            for(int i = 0; i < 4; i++) {
+                int v = base + cuboidFaces[f][i];
+                fx += batch.vx[v];
+                fy += batch.vy[v];
+                fz += batch.vz[v];
+            }
+            fx /= 4; fy /= 4; fz /= 4;
+            if ((fx - cx) * fx + (fy - cy) * fy + (fz - cz) * fz < 0)
+                mask |= 1 << f;
+        }
+        batch.facing[base] = mask;
+    }
+}
+
+static inline ProjectedVertex batchVertex(int i) {
+    ProjectedVertex p;
+    p.view = (Vec3){batch.vx[i], batch.vy[i], batch.vz[i]};
+    p.sx = batch.sx[i];
+    p.sy = batch.sy[i];
+    return p;
+}
+
+static inline int edgeHidden(int i) {
+    if (!hiddenEdgeRemoval || batch.edges[i].cuboid < 0) return 0;
+    unsigned char facing = batch.facing[batch.edges[i].cuboid];
+    unsigned char faces = batch.edges[i].faces;
+    return !(facing & (1 << (faces & 0x0f))) && !(facing & (1 << (faces >> 4)));
+}
+
+static inline int bandTop(int band) {
+    return band * screen.height / rasterThreadCount;
+}
+
+// Draw the edges binned to one band, clipped to its rows
+static void rasterBand(int band) {
+    int yMin = bandTop(band);
+    int yMax = bandTop(band + 1);
+    for(int k = 0; k < bandEdgeCount[band]; k++) {
+        int i = bandEdges[band][k];
+        ProjectedVertex v0 = batchVertex(batch.edges[i].v0);
+        ProjectedVertex v1 = batchVertex(batch.edges[i].v1);
         if(activeMSAA)
-            drawLineZ_Wu(
-                c0, c1,
-                WIDTH, HEIGHT, cuboid.color,
-                &screen
-            );
+            rasterLineZ_Wu(&v0, &v1, screen.width, screen.height, yMin, yMax, batch.edges[i].color, &screen);
         else
-            drawLineZ(
-                c0, c1,
-                WIDTH, HEIGHT, cuboid.color,
-                &screen
-            );
+            rasterLineZ(&v0, &v1, screen.width, screen.height, yMin, yMax, batch.edges[i].color, &screen);
+    }
+}
+
+static void *rasterWorker(void *arg) {
+    int band = (int)(intptr_t)arg;
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&rasterMutex);
+    while (1) {
+        while (rasterGeneration == seen)
+            pthread_cond_wait(&rasterStart, &rasterMutex);
+        seen = rasterGeneration;
+        // Workers stay parked after setRasterThreads() lowers the count; they
+        // still answer every job, but bands past the count have no rows
+        short active = band < rasterThreadCount;
+        pthread_mutex_unlock(&rasterMutex);
+
+        if (active) rasterJob(band);
+
+        pthread_mutex_lock(&rasterMutex);
+        if (--rasterPending == 0)
+            pthread_cond_signal(&rasterDone);
     }
+    return NULL;
+}
+
+void setRasterThreads(int count) {
+    if (count < 1) count = 1;
+    if (count > RASTER_MAX_THREADS) count = RASTER_MAX_THREADS;
+
+    pthread_mutex_lock(&rasterMutex);
+    for (int band = rasterWorkersStarted; band < count; band++) {
+        if (pthread_create(&rasterWorkers[band], NULL, rasterWorker, (void *)(intptr_t)band) != 0)
+            break;
+        pthread_detach(rasterWorkers[band]);
+        rasterWorkersStarted = band + 1;
+    }
+    rasterThreadCount = count < rasterWorkersStarted ? count : rasterWorkersStarted;
+    pthread_mutex_unlock(&rasterMutex);
+}
+
+// Run job once per band, in parallel, and wait for all of them
+static void runBands(void (*job)(int band)) {
+    if (rasterThreadCount == 1) {
+        job(0);
+        return;
+    }
+
+    pthread_mutex_lock(&rasterMutex);
+    rasterJob = job;
+    rasterPending = rasterWorkersStarted - 1;
+    rasterGeneration++;
+    pthread_cond_broadcast(&rasterStart);
+    pthread_mutex_unlock(&rasterMutex);
+
+    job(0);
+
+    pthread_mutex_lock(&rasterMutex);
+    while (rasterPending > 0)
+        pthread_cond_wait(&rasterDone, &rasterMutex);
+    pthread_mutex_unlock(&rasterMutex);
+}
+
+// Bin each edge to every band its (near-clipped) screen extent overlaps,
+// keeping batch order within a band, then rasterize the bands in parallel
+static void rasterBatch(void) {
+    if (hiddenEdgeRemoval) computeFacing();
+
+    if (rasterThreadCount == 1) {
+        for(int i = 0; i < batch.edgeCount; i++) {
+            if (edgeHidden(i)) continue;
+            ProjectedVertex v0 = batchVertex(batch.edges[i].v0);
+            ProjectedVertex v1 = batchVertex(batch.edges[i].v1);
+            drawProjectedLine(&v0, &v1, batch.edges[i].color);
+        }
+        return;
+    }
+
+    memset(bandEdgeCount, 0, sizeof(bandEdgeCount));
+    for(int i = 0; i < batch.edgeCount; i++) {
+        if (edgeHidden(i)) continue;
+        ProjectedVertex v0 = batchVertex(batch.edges[i].v0);
+        ProjectedVertex v1 = batchVertex(batch.edges[i].v1);
+        if (!clipNear(&v0, &v1)) continue;
+
+        // One row of margin for antialiasing coverage
+        double top = fmin(v0.sy, v1.sy) - 1.0;
+        double bottom = fmax(v0.sy, v1.sy) + 1.0;
+        for (int band = 0; band < rasterThreadCount; band++) {
+            if (bottom >= bandTop(band) && top < bandTop(band + 1))
+                bandEdges[band][bandEdgeCount[band]++] = i;
+        }
+    }
+
+    runBands(rasterBand);
+}
+
+void drawCuboid(const Cuboid cuboid) {
+    batchReset();
+    batchAddCuboid(&cuboid);
+    transformBatch();
+    rasterBatch();
 }
 
 void drawGun(const Gun gun) {
-    if(activeMSAA)
-        drawLineZ_Wu(
-        (Vec3){
-            gun.position.x,
-            gun.position.y,
-            gun.position.z
-        },
-        (Vec3){
-            gun.position.x + sin(gun.rotation_y) * gun.length,
-            gun.position.y,
-            gun.position.z + cos(gun.rotation_y) * gun.length
-        },
-        WIDTH, HEIGHT, gun.color,
-        &screen
-    );
-    else
-        drawLineZ(
-            (Vec3){
-                gun.position.x,
-                gun.position.y,
-                gun.position.z
-            },
-            (Vec3){
-                gun.position.x + sin(gun.rotation_y) * gun.length,
-                gun.position.y,
-                gun.position.z + cos(gun.rotation_y) * gun.length
-            },
-            WIDTH, HEIGHT, gun.color,
-            &screen
-        );
+    batchReset();
+    batchAddGun(&gun);
+    transformBatch();
+    rasterBatch();
 }
 
 void drawPlayer(const Player player) {
-    drawCuboid(player.cuboid);
-    drawGun(player.gun);
-    
-    // Draw extra cuboids at top left and top right
-    double offsetX = player.cuboid.width * 0.25;
-    double offsetY = player.cuboid.height * 0.25;
-    double smallSize = player.cuboid.width * 0.2;
-    
-    // Top left cuboid (in local space before rotation, use Z for left/right)
-    Vec3 topLeftLocal = {-offsetX, offsetY, 0};
-    Vec3 topLeftRotated = rotateY(topLeftLocal, player.cuboid.rotation_y);
-    Cuboid topLeft = {
-        .position = {
-            player.cuboid.position.x + topLeftRotated.x,
-            player.cuboid.position.y + topLeftRotated.y,
-            player.cuboid.position.z + topLeftRotated.z
-        },
-        .width = smallSize,
-        .height = smallSize,
-        .depth = smallSize,
-        .rotation_y = player.cuboid.rotation_y,
-        .color = player.cuboid.color
-    };
-    
-    // Top right cuboid (in local space before rotation, use Z for left/right)
-    Vec3 topRightLocal = {offsetX, offsetY, 0};
-    Vec3 topRightRotated = rotateY(topRightLocal, player.cuboid.rotation_y);
-    Cuboid topRight = {
-        .position = {
-            player.cuboid.position.x + topRightRotated.x,
-            player.cuboid.position.y + topRightRotated.y,
-            player.cuboid.position.z + topRightRotated.z
-        },
-        .width = smallSize,
-        .height = smallSize,
-        .depth = smallSize,
-        .rotation_y = player.cuboid.rotation_y,
-        .color = player.cuboid.color
-    };
-    
-    drawCuboid(topLeft);
-    drawCuboid(topRight);
+    batchReset();
+    batchAddPlayer(&player);
+    transformBatch();
+    rasterBatch();
 }
 
-void drawAllPlayers() {
-    for (short i = 0; i < 16; i++) {
-        if (players[i].hp > 0) {
-            drawPlayer(players[i]);
+// All live, potentially visible players go through a single batched transform
+void drawPlayers(const Player *playerList, short count) {
+    batchReset();
+    for (short i = 0; i < count; i++) {
+        if (playerList[i].hp > 0 && playerVisible(&playerList[i])) {
+            batchAddPlayer(&playerList[i]);
         }
     }
+    transformBatch();
+    rasterBatch();
+}
+
+void drawAllPlayers() {
+    drawPlayers(players, 16);
 }
 
 void movePlayer(short playerID, double forward, double right, double up, short globalCoordinates) {
@@ -515,7 +1058,7 @@ void changePlayerColor(short playerID, Color newColor) {
     players[playerID].gun.color = newColor;
 }
 
-void drawProjectiles(ProjectileQueue *queue) {
+void drawProjectiles(const ProjectileQueue *queue) {
     int index = queue->head;
     while (index != queue->tail) {
         Projectile proj = queue->projectiles[index];
@@ -529,17 +1072,17 @@ void drawProjectiles(ProjectileQueue *queue) {
         end.x += proj.position.x;
         end.y += proj.position.y;
         end.z += proj.position.z;
-        if(!proj.collided){
+        if(!proj.collided && sphereInFrustum(proj.position, fabs(proj.length) * 0.5)){
             if(activeMSAA)
                 drawLineZ_Wu(
                     start, end,
-                    WIDTH, HEIGHT, proj.color,
+                    screen.width, screen.height, proj.color,
                     &screen
                 );
             else
                 drawLineZ(
                     start, end,
-                    WIDTH, HEIGHT, proj.color,
+                    screen.width, screen.height, proj.color,
                     &screen
                 );
         }
@@ -564,7 +1107,7 @@ void shootProjectile(short playerID, ProjectileQueue *queue) {
     proj.position = players[playerID].gun.position;
     proj.length = 3.0;
     proj.rotation_y = players[playerID].gun.rotation_y;
-    proj.color = (Color){255, 255, 255};
+    proj.color = (Color){255, 255, 255, 0};
     proj.distance_left = PROJECTILE_TRAVEL_DISTANCE;
     proj.speed = PROJECTILE_TRAVEL_SPEED;
     proj.ownerID = playerID;
@@ -573,7 +1116,7 @@ void shootProjectile(short playerID, ProjectileQueue *queue) {
     enqueueProjectile(queue, proj);
 }
 
-void updateProjectiles(ProjectileQueue *queue, Player *players, short numPlayers, double deltaTime, short checkCollisions, CollisionCallback onCollision) {
+void updateProjectiles(ProjectileQueue *queue, Player *players, short numPlayers, double deltaTime, short checkCollisions, CollisionCallback onCollision, HitboxProvider hitboxes) {
     short index = queue->head;
     while (index != queue->tail) {
         Projectile *proj = &queue->projectiles[index];
@@ -589,14 +1132,16 @@ void updateProjectiles(ProjectileQueue *queue, Player *players, short numPlayers
 
             // Check for collisions with players (only on server)
             if (checkCollisions) {
+                // Test against the world as the shooter saw it, if a provider is given
+                const Player *targets = hitboxes ? hitboxes(proj->ownerID) : players;
                 for (short i = 0; i < numPlayers; i++) {
                     if (i != proj->ownerID && players[i].hp > 0) {
-                        if (projectileCuboidCollision(*proj, players[i].cuboid)) {
+                        if (projectileCuboidCollision(*proj, targets[i].cuboid)) {
                             // Collision detected
                             players[i].hp -= 1; // Decrease HP by 1
                             unsigned char newRed = (players[i].cuboid.color.red <= 204) ? (players[i].cuboid.color.red + 51) : 255;
                             unsigned char newGreen = (players[i].cuboid.color.green >= 51) ? (players[i].cuboid.color.green - 51) : 0;
-                            changePlayerColor(i, (Color){newRed, newGreen, 0});
+                            changePlayerColor(i, (Color){newRed, newGreen, 0, 0});
                             // Remove projectile
                             proj->collided = 1;
                             // Call collision callback if provided
@@ -618,108 +1163,701 @@ void updateProjectiles(ProjectileQueue *queue, Player *players, short numPlayers
     }
 }
 
+// Blank a whole frame: spaces, farthest depth, black, no dirty spans
+static void resetFrame(FrameBuffer *frame) {
+    size_t count = (size_t)frame->width * frame->height;
+    memset(frame->pixels, ' ', count);
+    memset(frame->zbuffer, ZBUFFER_FAR_BYTE, count * sizeof(float));
+    memset(frame->color, 0, count * sizeof(Color));
+    for (int y = 0; y < frame->height; y++) {
+        frame->dirtyMinX[y] = frame->width;
+        frame->dirtyMaxX[y] = -1;
+    }
+}
+
+// After a full reset (first frame or resize), only the spans drawn last
+// frame need clearing
 void clearScreen() {
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            screen.pixels[y][x] = ' ';
-            screen.zbuffer[y][x] = 1000.0f; // Initialize zbuffer to farthest depth
-            screen.color[y][x] = (Color){0,0,0}; // Default color black
+    if (!screen.pixels) setOutputSize(outputColumns, outputRows);
+    if (frameNeedsReset) {
+        resetFrame(&screen);
+        frameNeedsReset = 0;
+        return;
+    }
+    char  (*pixels)[screen.width]  = FRAME_PIXELS(&screen);
+    float (*zbuffer)[screen.width] = FRAME_ZBUFFER(&screen);
+    Color (*color)[screen.width]   = FRAME_COLOR(&screen);
+    for (int y = 0; y < screen.height; y++) {
+        int minX = screen.dirtyMinX[y];
+        int count = screen.dirtyMaxX[y] - minX + 1;
+        if (count <= 0) continue;
+        memset(&pixels[y][minX], ' ', count);
+        memset(&zbuffer[y][minX], ZBUFFER_FAR_BYTE, count * sizeof(float));
+        memset(&color[y][minX], 0, count * sizeof(Color));
+        screen.dirtyMinX[y] = screen.width;
+        screen.dirtyMaxX[y] = -1;
+    }
+}
+
+// Force the next frame to be emitted in full (e.g. after the terminal was cleared)
+void invalidateFrame() {
+    shownValid = 0;
+}
+
+static int appendDecimal(int index, int value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (n > 0) frameString[index++] = digits[--n];
+    return index;
+}
+
+// Palette index of every color, looked up by its top PALETTE_LUT_BITS bits
+// per channel. Built by setColorMode for the indexed modes.
+#define PALETTE_LUT_BITS 5
+static unsigned char paletteLUT[1 << (3 * PALETTE_LUT_BITS)];
+
+// xterm's default values for the 16 ANSI colors
+static const Color ansiPalette[16] = {
+    {0, 0, 0, 0}, {205, 0, 0, 0}, {0, 205, 0, 0}, {205, 205, 0, 0},
+    {0, 0, 238, 0}, {205, 0, 205, 0}, {0, 205, 205, 0}, {229, 229, 229, 0},
+    {127, 127, 127, 0}, {255, 0, 0, 0}, {0, 255, 0, 0}, {255, 255, 0, 0},
+    {92, 92, 255, 0}, {255, 0, 255, 0}, {0, 255, 255, 0}, {255, 255, 255, 0}
+};
+
+// RGB of a 256-color palette index from 16 up (the first 16 are left out
+// since terminals disagree on them)
+static Color xtermColor(int index) {
+    static const unsigned char cubeLevels[6] = {0, 95, 135, 175, 215, 255};
+    if (index >= 232) {
+        unsigned char gray = 8 + 10 * (index - 232);
+        return (Color){gray, gray, gray, 0};
+    }
+    index -= 16;
+    return (Color){cubeLevels[index / 36], cubeLevels[(index / 6) % 6], cubeLevels[index % 6], 0};
+}
+
+static void buildPaletteLUT(short mode) {
+    int first = mode == COLOR_MODE_256 ? 16 : 0;
+    int last = mode == COLOR_MODE_256 ? 255 : 15;
+    int levels = 1 << PALETTE_LUT_BITS;
+    int shift = 8 - PALETTE_LUT_BITS;
+
+    for (int r = 0; r < levels; r++) {
+        for (int g = 0; g < levels; g++) {
+            for (int b = 0; b < levels; b++) {
+                // Nearest palette entry to the middle of this bucket
+                int cr = (r << shift) | (1 << (shift - 1));
+                int cg = (g << shift) | (1 << (shift - 1));
+                int cb = (b << shift) | (1 << (shift - 1));
+                int best = first, bestDistance = INT_MAX;
+                for (int i = first; i <= last; i++) {
+                    Color p = mode == COLOR_MODE_256 ? xtermColor(i) : ansiPalette[i];
+                    int dr = cr - p.red, dg = cg - p.green, db = cb - p.blue;
+                    int distance = dr * dr + dg * dg + db * db;
+                    if (distance < bestDistance) {
+                        bestDistance = distance;
+                        best = i;
+                    }
+                }
+                paletteLUT[(r << (2 * PALETTE_LUT_BITS)) | (g << PALETTE_LUT_BITS) | b] = best;
+            }
         }
     }
 }
 
-void generateframeString() {
-    int index = 0;
+// A color's red, green and blue bytes as one word, for single compares
+static inline uint32_t colorBits(Color c) {
+    uint32_t bits;
+    c.pad = 0;
+    memcpy(&bits, &c, sizeof(bits));
+    return bits;
+}
+
+static inline int sameColor(Color a, Color b) {
+    return colorBits(a) == colorBits(b);
+}
+
+// What a color is sent to the terminal as in the active mode: its
+// colorBits() for truecolor, otherwise a palette index. Cells whose colors
+// map to the same value share one SGR.
+static inline unsigned int terminalColor(Color c) {
+    if (activeColorMode == COLOR_MODE_TRUECOLOR) return colorBits(c);
+    int shift = 8 - PALETTE_LUT_BITS;
+    return paletteLUT[(c.red >> shift) << (2 * PALETTE_LUT_BITS) | (c.green >> shift) << PALETTE_LUT_BITS | c.blue >> shift];
+}
+
+// Decimal text of every byte value followed by ';', padded to four bytes
+// so it is written with one fixed-size copy; the length includes the ';'
+static char decimalText[256][4];
+static unsigned char decimalLength[256];
+
+static void buildDecimalTable(void) {
+    for (int value = 0; value < 256; value++) {
+        char *text = decimalText[value];
+        int n = 0;
+        if (value >= 100) text[n++] = '0' + value / 100;
+        if (value >= 10) text[n++] = '0' + (value / 10) % 10;
+        text[n++] = '0' + value % 10;
+        text[n++] = ';';
+        decimalLength[value] = n;
+    }
+}
+
+// "value;" from the table. The copy may run up to three bytes past the
+// text, which the next write overwrites or FRAME_STRING_SIZE leaves room for.
+static inline char *appendByteText(char *out, unsigned int value) {
+    memcpy(out, decimalText[value], 4);
+    return out + decimalLength[value];
+}
+
+// SGR parameters selecting a terminalColor() value as foreground or
+// background, followed by ';'
+static int appendColor(int index, unsigned int color, short background) {
+    char *out = frameString + index;
+    if (activeColorMode == COLOR_MODE_16) {
+        // 30-37/40-47, or 90-97/100-107 for the bright half
+        if (color >= 8) {
+            memcpy(out, background ? "10" : "9", 2);
+            out += background ? 2 : 1;
+        } else {
+            *out++ = background ? '4' : '3';
+        }
+        *out++ = '0' + (color & 7);
+        *out++ = ';';
+        return out - frameString;
+    }
+
+    if (activeColorMode == COLOR_MODE_256) {
+        memcpy(out, background ? "48;5;" : "38;5;", 5);
+        return appendByteText(out + 5, color) - frameString;
+    }
+    Color rgb;
+    memcpy(&rgb, &color, sizeof(rgb));
+    memcpy(out, background ? "48;2;" : "38;2;", 5);
+    out = appendByteText(out + 5, rgb.red);
+    out = appendByteText(out, rgb.green);
+    return appendByteText(out, rgb.blue) - frameString;
+}
+
+// Colors currently set on the terminal while a frame is emitted
+typedef struct {
+    unsigned int fg, bg;        // terminalColor() values
+    short fgSet, bgSet;
+} TerminalColors;
+
+
+// What a cell shows: its colors as terminalColor() values and its glyph,
+// the pixel's character in normal mode, and in half-block mode ' ' when both
+// pixels show as the same color or 0 for "▀▀"
+typedef struct {
+    unsigned int fg, bg;
+    char glyph;
+} CellLook;
+
+static inline CellLook cellLook(const FrameBuffer *source, size_t top, size_t bottom) {
+    CellLook look = {0, terminalColor(source->color[bottom]), source->pixels[top]};
+    if (rowsPerCell == 2) {
+        unsigned int fg = terminalColor(source->color[top]);
+        look.glyph = fg != look.bg ? 0 : ' ';
+        if (fg != look.bg) look.fg = fg;
+    }
+    return look;
+}
+
+// Switch the terminal to a cell's colors where they differ from what is set
+static int applyColors(int index, CellLook look, TerminalColors *term) {
+    short setFg = look.glyph == 0 && (!term->fgSet || term->fg != look.fg);
+    short setBg = !term->bgSet || term->bg != look.bg;
+    if (setFg || setBg) {
+        frameString[index++] = '\033';
+        frameString[index++] = '[';
+        if (setFg) {
+            index = appendColor(index, look.fg, 0);
+            term->fg = look.fg;
+            term->fgSet = 1;
+        }
+        if (setBg) {
+            index = appendColor(index, look.bg, 1);
+            term->bg = look.bg;
+            term->bgSet = 1;
+        }
+        frameString[index - 1] = 'm';  // In place of the last parameter's ';'
+    }
+    return index;
+}
+
+static inline void markShown(const FrameBuffer *source, size_t top, size_t bottom) {
+    shownPixels[top] = source->pixels[top];
+    shownColor[top] = source->color[top];
+    if (rowsPerCell == 2) {
+        shownPixels[bottom] = source->pixels[bottom];
+        shownColor[bottom] = source->color[bottom];
+    }
+}
+
+// Emit one cell, two columns wide, switching colors only where they differ
+// from what is currently set on the terminal. A normal cell is the pixel's
+// glyph plus a spacer on its background color. A half-block cell shows its
+// top pixel as the foreground of "▀▀" over its bottom pixel as background,
+// or two spaces when both pixels show as the same color.
+static int emitCell(const FrameBuffer *source, int index, int x, int row, TerminalColors *term) {
+    size_t top = ((size_t)row * rowsPerCell) * source->width + x;
+    size_t bottom = top + (size_t)(rowsPerCell - 1) * source->width;
+    CellLook look = cellLook(source, top, bottom);
+    index = applyColors(index, look, term);
+
+    if (look.glyph == 0) {
+        memcpy(&frameString[index], "\xe2\x96\x80\xe2\x96\x80", 6);     // "▀▀"
+        index += 6;
+    } else {
+        frameString[index++] = look.glyph;
+        frameString[index++] = ' ';
+    }
+    markShown(source, top, bottom);
+    return index;
+}
+
+// Number of cells from x on that look the same as x, up to the row's end
+static int runLength(const FrameBuffer *source, CellLook look, int x, int row) {
+    size_t top = ((size_t)row * rowsPerCell) * source->width;
+    size_t bottom = top + (size_t)(rowsPerCell - 1) * source->width;
+    int end = x + 1;
+    while (end < source->width) {
+        CellLook next = cellLook(source, top + end, bottom + end);
+        if (next.glyph != look.glyph || next.bg != look.bg || next.fg != look.fg) break;
+        end++;
+    }
+    return end - x;
+}
+
+// Emit `count` identical cells starting at x with the active run encoding:
+// blank cells as ECH (erase in the background color) plus CUF to step over
+// them, or with REP as one space repeated; "▀▀" cells with REP as one cell
+// and its glyph repeated. Returns the output index; the cursor ends up after
+// the run, except that a blank run reaching the row's end is left unskipped.
+static int emitRun(const FrameBuffer *source, int index, int x, int row, int count, TerminalColors *term) {
+    size_t top = ((size_t)row * rowsPerCell) * source->width + x;
+    size_t bottom = top + (size_t)(rowsPerCell - 1) * source->width;
+    CellLook look = cellLook(source, top, bottom);
+    index = applyColors(index, look, term);
+
+    int columns = 2 * count;
+    if (look.glyph == 0) {
+        memcpy(&frameString[index], "\xe2\x96\x80", 3);      // "▀", then repeated
+        index += 3;
+        columns--;
+    } else if (activeRunEncoding == RUN_ENCODING_REPEAT) {
+        frameString[index++] = ' ';
+        columns--;
+    }
+
     frameString[index++] = '\033';
     frameString[index++] = '[';
-    frameString[index++] = 'H';
-    Color currentColor = {255, 255, 255};
+    index = appendDecimal(index, columns);
+    if (activeRunEncoding == RUN_ENCODING_REPEAT) {
+        frameString[index++] = 'b';
+    } else {
+        frameString[index++] = 'X';
+        if (x + count < source->width) {
+            frameString[index++] = '\033';
+            frameString[index++] = '[';
+            index = appendDecimal(index, columns);
+            frameString[index++] = 'C';
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        markShown(source, top + i, bottom + i);
+    return index;
+}
+
+// First cell at or after x on a cell row whose pixels differ from what was
+// last emitted, or width if none do. Kept apart from the emitting loop so the
+// common all-unchanged scan stays tight.
+static int nextChangedCell(const char *pixels, const Color *color, const char *seenPixels, const Color *seenColor,
+                           size_t bottomOffset, short halfBlock, int x, int width) {
+    for (; x < width; x++) {
+        if (seenPixels[x] != pixels[x] || !sameColor(seenColor[x], color[x])) return x;
+        if (halfBlock && (seenPixels[x + bottomOffset] != pixels[x + bottomOffset] ||
+                          !sameColor(seenColor[x + bottomOffset], color[x + bottomOffset]))) return x;
+    }
+    return width;
+}
+
+// Build the terminal update for the current frame: only cells that differ
+// from what was last emitted, with cursor-positioning escapes between runs
+// and, if enabled, long stretches of identical cells run-encoded.
+// With the AA post-process active the blurred buffer is emitted instead.
+void generateframeString() {
+    const FrameBuffer *source = activePostProcess == POST_PROCESS_AA ? &antiAliased : &screen;
+    int index = 0;
+    TerminalColors term = {0};  // The previous frame ended with a color reset
+    int width = source->width;
+    int rows = source->height / rowsPerCell;
+    short diffing = shownValid, halfBlock = rowsPerCell == 2;
+    short runEncoding = activeRunEncoding;
     
-    for (int y = 0; y < HEIGHT; y++) {
-        for (int x = 0; x < WIDTH; x++) {
-            //Apply color
-            if(x == 0 && y == 0 ||
-                screen.color[y][x].red != currentColor.red ||
-                screen.color[y][x].green != currentColor.green ||
-                screen.color[y][x].blue != currentColor.blue) {
+    for (int row = 0; row < rows; row++) {
+        // Framebuffer rows of this cell row (the bottom one only in half-block mode)
+        size_t rowStart = (size_t)row * rowsPerCell * width;
+        size_t bottomOffset = (size_t)(rowsPerCell - 1) * width;
+
+        int cursorX = -1;  // Cell the cursor sits on, if positioned on this row
+        for (int x = 0; x < width; x++) {
+            if (diffing) {
+                x = nextChangedCell(source->pixels + rowStart, source->color + rowStart,
+                                    shownPixels + rowStart, shownColor + rowStart,
+                                    bottomOffset, halfBlock, x, width);
+                if (x == width) break;
+            }
+
+            if (cursorX >= 0 && x > cursorX && x - cursorX <= DIFF_MAX_GAP) {
+                // Rewriting a few unchanged cells is cheaper than moving the cursor
+                while (cursorX < x) {
+                    index = emitCell(source, index, cursorX, row, &term);
+                    cursorX++;
+                }
+            } else if (cursorX != x) {
+                // Move cursor: ESC [ row ; col H (1-based, two columns per cell)
                 frameString[index++] = '\033';
                 frameString[index++] = '[';
-                frameString[index++] = '4';
-                frameString[index++] = '8';
-                frameString[index++] = ';';
-                frameString[index++] = '2';
-                frameString[index++] = ';';
-                
-                int r = screen.color[y][x].red, g = screen.color[y][x].green, b = screen.color[y][x].blue;
-                
-                // Red
-                if (r >= 100) frameString[index++] = '0' + r / 100;
-                if (r >= 10) frameString[index++] = '0' + (r / 10) % 10;
-                frameString[index++] = '0' + r % 10;
+                index = appendDecimal(index, row + 1);
                 frameString[index++] = ';';
-                
-                // Green
-                if (g >= 100) frameString[index++] = '0' + g / 100;
-                if (g >= 10) frameString[index++] = '0' + (g / 10) % 10;
-                frameString[index++] = '0' + g % 10;
-                frameString[index++] = ';';
-                
-                // Blue
-                if (b >= 100) frameString[index++] = '0' + b / 100;
-                if (b >= 10) frameString[index++] = '0' + (b / 10) % 10;
-                frameString[index++] = '0' + b % 10;
-                
-                frameString[index++] = 'm';
-                currentColor = screen.color[y][x];
+                index = appendDecimal(index, 2 * x + 1);
+                frameString[index++] = 'H';
             }
-            
-            frameString[index++] = screen.pixels[y][x];
-            frameString[index++] = ' ';
+
+            if (runEncoding) {
+                size_t top = rowStart + x;
+                CellLook look = cellLook(source, top, top + bottomOffset);
+                if (look.glyph == ' ' || (look.glyph == 0 && runEncoding == RUN_ENCODING_REPEAT)) {
+                    int count = runLength(source, look, x, row);
+                    if (count >= RUN_MIN_CELLS) {
+                        index = emitRun(source, index, x, row, count, &term);
+                        x += count - 1;
+                        cursorX = x + 1;
+                        continue;
+                    }
+                }
+            }
+            index = emitCell(source, index, x, row, &term);
+            cursorX = x + 1;
         }
-        frameString[index++] = '\n';
     }
-    // Reset color
-    frameString[index++] = '\033';
-    frameString[index++] = '[';
-    frameString[index++] = '0';;
-    frameString[index++] = 'm';
+    shownValid = 1;
+
+    if (index > 0) {
+        // Reset color
+        frameString[index++] = '\033';
+        frameString[index++] = '[';
+        frameString[index++] = '0';
+        frameString[index++] = 'm';
+    }
     // Null-terminate the string
     frameString[index] = '\0';
     frameStringSize = index;
 }
 
-void applyAA(){
+// Original 3x3 kernel, weights renormalized where it hangs off the screen
+static void applyAAPixel(int x, int y) {
     const int coefficients[] = {1, 2, 1,
                               2, 6, 2,
                               1, 2, 1};
-    for(int y = 0; y < HEIGHT; y++){
-        for(int x = 0; x < WIDTH; x++){
-            int r = 0, g = 0, b = 0;
-            int count = 0;
-            for(int dy = -1; dy <= 1; dy++){
-                for(int dx = -1; dx <= 1; dx++){
-                    int nx = x + dx;
-                    int ny = y + dy;
-                    if(nx >= 0 && nx < WIDTH && ny >= 0 && ny < HEIGHT){
-                        int currentCoef = coefficients[(dy + 1) * 3 + (dx + 1)];
-                        r += screen.color[ny][nx].red * currentCoef;
-                        g += screen.color[ny][nx].green * currentCoef;
-                        b += screen.color[ny][nx].blue * currentCoef;
-                        count += currentCoef;
-                    }
-                }
+    Color (*source)[screen.width] = FRAME_COLOR(&screen);
+    Color (*target)[antiAliased.width] = FRAME_COLOR(&antiAliased);
+    int r = 0, g = 0, b = 0;
+    int count = 0;
+    for(int dy = -1; dy <= 1; dy++){
+        for(int dx = -1; dx <= 1; dx++){
+            int nx = x + dx;
+            int ny = y + dy;
+            if(nx >= 0 && nx < screen.width && ny >= 0 && ny < screen.height){
+                int currentCoef = coefficients[(dy + 1) * 3 + (dx + 1)];
+                r += source[ny][nx].red * currentCoef;
+                g += source[ny][nx].green * currentCoef;
+                b += source[ny][nx].blue * currentCoef;
+                count += currentCoef;
             }
-            antiAliased.color[y][x].red = r / count;
-            antiAliased.color[y][x].green = g / count;
-            antiAliased.color[y][x].blue = b / count;
-            antiAliased.pixels[y][x] = screen.pixels[y][x];
         }
     }
+    target[y][x].red = r / count;
+    target[y][x].green = g / count;
+    target[y][x].blue = b / count;
+    target[y][x].pad = 0;
+}
+
+// In the interior the kernel is outer([1 2 1], [1 2 1]) plus 2x the center,
+// over 18, so it runs as a horizontal then a vertical [1 2 1] pass. Lanes are
+// the 4 bytes of a Color widened to 32 bits.
+typedef unsigned char v4uc __attribute__((vector_size(4)));
+typedef unsigned int v4u __attribute__((vector_size(16)));
+
+// (sum * AA_DIV18_MUL) >> 16 == sum / 18 for every sum up to 18 * 255
+#define AA_DIV18_MUL 3641
+
+// Three rolling rows of horizontal sums (4 lanes per pixel) per band
+static unsigned int *aaRows;
+
+static inline v4u loadColor(const Color *c) {
+    v4uc bytes;
+    memcpy(&bytes, c, sizeof(bytes));
+    return __builtin_convertvector(bytes, v4u);
+}
+
+// [1 2 1] across the interior columns of row y
+static void aaHorizontalPass(int y, unsigned int *out) {
+    const Color *row = FRAME_COLOR(&screen)[y];
+    for(int x = 1; x < screen.width - 1; x++){
+        v4u sum = loadColor(&row[x - 1]) + 2 * loadColor(&row[x]) + loadColor(&row[x + 1]);
+        memcpy(&out[x * 4], &sum, sizeof(sum));
+    }
+}
+
+static void aaBand(int band) {
+    int width = screen.width;
+    int yMin = bandTop(band);
+    int yMax = bandTop(band + 1);
+    unsigned int (*rows)[width * 4] = (unsigned int (*)[width * 4])&aaRows[(size_t)band * 3 * width * 4];
+    Color (*source)[width] = FRAME_COLOR(&screen);
+    Color (*target)[width] = FRAME_COLOR(&antiAliased);
+    int summed = -2;    // Last row whose horizontal sums are in rows[]
+
+    for(int y = yMin; y < yMax; y++){
+        memcpy(FRAME_PIXELS(&antiAliased)[y], FRAME_PIXELS(&screen)[y], width);
+        if(y == 0 || y == screen.height - 1){
+            for(int x = 0; x < width; x++) applyAAPixel(x, y);
+            continue;
+        }
+
+        for(int r = (summed < y - 1) ? y - 1 : summed + 1; r <= y + 1; r++)
+            aaHorizontalPass(r, rows[r % 3]);
+        summed = y + 1;
+
+        const unsigned int *up = rows[(y - 1) % 3];
+        const unsigned int *mid = rows[y % 3];
+        const unsigned int *down = rows[(y + 1) % 3];
+        for(int x = 1; x < width - 1; x++){
+            v4u a, b, c;
+            memcpy(&a, &up[x * 4], sizeof(a));
+            memcpy(&b, &mid[x * 4], sizeof(b));
+            memcpy(&c, &down[x * 4], sizeof(c));
+            v4u sum = a + 2 * b + c + 2 * loadColor(&source[y][x]);
+            v4uc out = __builtin_convertvector((sum * AA_DIV18_MUL) >> 16, v4uc);
+            memcpy(&target[y][x], &out, sizeof(out));
+        }
+        applyAAPixel(0, y);
+        applyAAPixel(width - 1, y);
+    }
+}
+
+// Blur screen into antiAliased, split across the raster bands
+void applyAA(){
+    runBands(aaBand);
+}
+
+// Terminal writer thread. A frame is only generated when the writer is idle,
+// because generateframeString() diffs against the last generated frame and so
+// every generated frame must reach the terminal, in order.
+static pthread_t writerThread;
+static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writerWake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t writerIdle = PTHREAD_COND_INITIALIZER;
+static int writerFd = -1;
+static short writerStarted = 0;
+static short writerRunning = 0;
+static short writerBusy = 0;            // A handed-off frame is not fully written yet
+static const char *writerData;
+static unsigned long writerSize;
+
+static void writeAll(int fd, const char *data, unsigned long size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        data += written;
+        size -= written;
+    }
+}
+
+static void *frameWriter(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&writerMutex);
+    while (1) {
+        while (writerRunning && !writerBusy)
+            pthread_cond_wait(&writerWake, &writerMutex);
+        if (!writerBusy) break;     // Stopped with nothing left to write
+        const char *data = writerData;
+        unsigned long size = writerSize;
+        pthread_mutex_unlock(&writerMutex);
+
+        writeAll(writerFd, data, size);
+
+        pthread_mutex_lock(&writerMutex);
+        writerBusy = 0;
+        pthread_cond_broadcast(&writerIdle);
+    }
+    pthread_mutex_unlock(&writerMutex);
+    return NULL;
+}
+
+// Move terminal writes off the calling thread; render() then only hands off
+void startFrameWriter(int fd) {
+    if (writerStarted) return;
+    writerFd = fd;
+    writerRunning = 1;
+    if (pthread_create(&writerThread, NULL, frameWriter, NULL) != 0) {
+        writerRunning = 0;
+        return;
+    }
+    writerStarted = 1;
+}
+
+// Finish the frame in flight (if any) and stop the writer
+void stopFrameWriter(void) {
+    if (!writerStarted) return;
+    pthread_mutex_lock(&writerMutex);
+    writerRunning = 0;
+    pthread_cond_signal(&writerWake);
+    pthread_mutex_unlock(&writerMutex);
+    pthread_join(writerThread, NULL);
+    writerStarted = 0;
+}
+
+// Whether a new frame can be generated now. Counts a dropped frame if not.
+int frameWriterReady(void) {
+    if (!writerStarted) return 1;
+    pthread_mutex_lock(&writerMutex);
+    int ready = !writerBusy;
+    pthread_mutex_unlock(&writerMutex);
+    if (!ready) droppedFrames++;
+    return ready;
 }
 
 void render(){
-    //clear screen
-    write(STDOUT_FILENO, frameString, frameStringSize);
+    if (!writerStarted) {
+        writeAll(STDOUT_FILENO, frameString, frameStringSize);
+        return;
+    }
+
+    // Hand the finished frame to the writer; the next one is only generated
+    // once it is idle again, so the buffer is not touched while being written
+    pthread_mutex_lock(&writerMutex);
+    writerData = frameString;
+    writerSize = frameStringSize;
+    writerBusy = 1;
+    pthread_cond_signal(&writerWake);
+    pthread_mutex_unlock(&writerMutex);
+}
+
+static void freeFrame(FrameBuffer *frame) {
+    free(frame->pixels);
+    free(frame->zbuffer);
+    free(frame->color);
+    free(frame->dirtyMinX);
+    free(frame->dirtyMaxX);
+}
+
+// Allocate a width x height framebuffer into *frame. Returns -1, with
+// nothing left allocated, if memory ran out.
+static int allocFrame(FrameBuffer *frame, int width, int height) {
+    size_t count = (size_t)width * height;
+    FrameBuffer resized = {.width = width, .height = height};
+    resized.pixels = malloc(count);
+    resized.zbuffer = malloc(count * sizeof(float));
+    resized.color = malloc(count * sizeof(Color));
+    resized.dirtyMinX = malloc(height * sizeof(short));
+    resized.dirtyMaxX = malloc(height * sizeof(short));
+    if (!resized.pixels || !resized.zbuffer || !resized.color || !resized.dirtyMinX || !resized.dirtyMaxX) {
+        freeFrame(&resized);
+        return -1;
+    }
+    *frame = resized;
+    return 0;
+}
+
+// Size every frame and output buffer for columns x rows terminal cells
+// (half-block mode renders two framebuffer rows per cell). Waits for the
+// frame being written, if any. Returns -1 if memory ran out.
+int setOutputSize(int columns, int rows) {
+    int width = columns;
+    int height = rows * rowsPerCell;
+    size_t count = (size_t)width * height;
+
+    if (writerStarted) {
+        pthread_mutex_lock(&writerMutex);
+        while (writerBusy)
+            pthread_cond_wait(&writerIdle, &writerMutex);
+        pthread_mutex_unlock(&writerMutex);
+    }
+
+    if (!decimalLength[0]) buildDecimalTable();
+
+    char *output = malloc(FRAME_STRING_SIZE(width, height));
+    char *seenPixels = malloc(count);
+    Color *seenColor = malloc(count * sizeof(Color));
+    unsigned int *rowSums = malloc((size_t)RASTER_MAX_THREADS * 3 * width * 4 * sizeof(unsigned int));
+    FrameBuffer newScreen = {0}, newAntiAliased = {0};
+    // Nothing is replaced until every allocation succeeded, so a failure
+    // leaves the previous size fully intact
+    if (!output || !seenPixels || !seenColor || !rowSums ||
+        allocFrame(&newScreen, width, height) < 0 || allocFrame(&newAntiAliased, width, height) < 0) {
+        freeFrame(&newScreen);
+        free(output);
+        free(seenPixels);
+        free(seenColor);
+        free(rowSums);
+        return -1;
+    }
+
+    freeFrame(&screen);
+    freeFrame(&antiAliased);
+    screen = newScreen;
+    antiAliased = newAntiAliased;
+    free(frameString);
+    frameString = output;
+    frameStringSize = 0;
+    free(shownPixels);
+    free(shownColor);
+    shownPixels = seenPixels;
+    shownColor = seenColor;
+    free(aaRows);
+    aaRows = rowSums;
+
+    outputColumns = columns;
+    outputRows = rows;
+    resetFrame(&antiAliased);
+    frameNeedsReset = 1;
+    shownValid = 0;
+    view.ready = 0;
+    return 0;
+}
+
+void setHalfBlockMode(short activate){
+    short previousMode = halfBlockMode;
+    int previousRows = rowsPerCell;
+    halfBlockMode = activate;
+    rowsPerCell = activate ? 2 : 1;
+    // Keep the old mode if the buffers could not be resized for the new one
+    if (screen.pixels && setOutputSize(outputColumns, outputRows) < 0) {
+        halfBlockMode = previousMode;
+        rowsPerCell = previousRows;
+    }
+}
+
+void setColorMode(short mode){
+    if (mode != COLOR_MODE_TRUECOLOR) buildPaletteLUT(mode);
+    activeColorMode = mode;
+    shownValid = 0;
+}
+
+void setRunEncoding(short mode){
+    activeRunEncoding = mode;
 }
 
 void ctrlcHandler(int signum) {
@@ -730,10 +1868,19 @@ void ctrlcHandler(int signum) {
 
 void moveCamera(Vec3 newPosition){
     playerCamera.position = newPosition;
+    updateView();
 }
 
 void setCameraRotation(double theta){
     playerCamera.yaw = theta;
+    updateView();
+}
+
+// Seconds on CLOCK_MONOTONIC, for timestamps compared within one process
+double getMonotonicTime(void){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1000000000.0;
 }
 
 // int main() {
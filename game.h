@@ -13,13 +13,38 @@
 #include <signal.h>
 #include <limits.h>
 #include <stdint.h>
+#include <errno.h>
 
 // Constants
-#define WIDTH 400
+#define WIDTH 400   // Default output size in terminal cells (each two columns wide)
 #define HEIGHT 220
 #define FOV 100.0
+#define NEAR_PLANE 0.5  // Lines are clipped to view-space z >= NEAR_PLANE
 #define PI 3.14159265359
 #define FRAME_INTERVAL_NS (6060606L)  // 165 FPS
+#define RASTER_MAX_THREADS 8            // Horizontal screen bands rasterized in parallel
+
+// Post-process applied between drawing and generateframeString
+#define POST_PROCESS_NONE 0
+#define POST_PROCESS_AA   1     // 3x3 blur of screen into antiAliased, which is then emitted
+
+// Color encodings generateframeString can emit
+#define COLOR_MODE_TRUECOLOR 0  // ESC[48;2;r;g;bm
+#define COLOR_MODE_256       1  // ESC[48;5;nm, xterm 6x6x6 cube and gray ramp
+#define COLOR_MODE_16        2  // ESC[4nm / ESC[10nm, the basic ANSI colors
+
+// How generateframeString shortens runs of identical cells
+#define RUN_ENCODING_NONE   0   // Every cell printed
+#define RUN_ENCODING_ERASE  1   // Blank runs erased with ECH and stepped over with CUF
+#define RUN_ENCODING_REPEAT 2   // Blank and "▀▀" runs printed once and repeated with REP
+#define RUN_MIN_CELLS 4         // Shorter runs are cheaper to print
+
+// Worst case output per framebuffer pixel: cursor move (10) + background SGR (19)
+// + 2 glyphs. A half-block cell (two pixels) needs at most 10 + 36 + 6.
+#define FRAME_STRING_SIZE(width, height) ((width) * (height) * 31 + 16)
+// Unchanged cells between two changed ones are re-emitted, rather than
+// jumping the cursor, when the gap is at most this many cells
+#define DIFF_MAX_GAP 3
 
 // Movement and rotation speeds (per second)
 #define MOVE_SPEED 8.0  // 8 units a second
@@ -38,6 +63,7 @@ typedef struct {
     unsigned char red;
     unsigned char green;
     unsigned char blue;
+    unsigned char pad;      // Keeps Color 4 bytes so it can be stored/compared as one word
 } Color;
 
 typedef struct {
@@ -45,20 +71,20 @@ typedef struct {
     double width, height, depth;
     double rotation_y;
     Color color;
-} Cuboid; //59 Bytes
+} Cuboid; //60 Bytes
 
 typedef struct {
     Vec3 position;
     double length;
     double rotation_y;
     Color color;
-} Gun; //29 Bytes
+} Gun; //30 Bytes
 
 typedef struct {
     Cuboid cuboid;
     Gun gun;
     short hp;
-} Player; // 90 Bytes
+} Player; // 92 Bytes
 
 typedef struct {
     Vec3 position;
@@ -87,24 +113,52 @@ typedef struct {
     double yaw;   // Rotation around Y axis
 } Camera;
 
+// Filling the zbuffer with this byte gives every cell a huge positive depth
+// (0x7f7f7f7f ~ 3.4e38f), so clearing depth is a plain memset
+#define ZBUFFER_FAR_BYTE 0x7f
+
+// Row-major buffers of height rows by width pixels, sized by setOutputSize()
 typedef struct {
-    char pixels[HEIGHT][WIDTH];
-    float zbuffer[HEIGHT][WIDTH];
-    Color color[HEIGHT][WIDTH];
+    int width, height;
+    char *pixels;
+    float *zbuffer;
+    Color *color;
+    // Per-row span of columns drawn since the last clear (min > max: clean row)
+    short *dirtyMinX;
+    short *dirtyMaxX;
 } FrameBuffer;
 
+// 2D views of a FrameBuffer's buffers: FRAME_COLOR(frame)[y][x]
+#define FRAME_PIXELS(frame)  ((char (*)[(frame)->width])(frame)->pixels)
+#define FRAME_ZBUFFER(frame) ((float (*)[(frame)->width])(frame)->zbuffer)
+#define FRAME_COLOR(frame)   ((Color (*)[(frame)->width])(frame)->color)
+
 // Global variable declarations (extern)
 extern Player players[16];
 extern ProjectileQueue projectileQueue;
 extern Camera playerCamera;
 extern FrameBuffer screen;
 extern FrameBuffer antiAliased;
-extern char frameString[7 + HEIGHT * WIDTH * (21) + HEIGHT + 1 + 4];
+extern char *frameString;               // Buffer generateframeString() fills
 extern unsigned long frameStringSize;
+extern unsigned long droppedFrames;     // Frames skipped while the writer was busy
 extern short activeMSAA;
+extern short hiddenEdgeRemoval;
+extern short activePostProcess;
+extern short halfBlockMode;
+extern short activeColorMode;
+extern short activeRunEncoding;
+extern int outputColumns, outputRows;
 
 // Function declarations
 void setActiveMSAA(short activate);
+void setHiddenEdgeRemoval(short activate);
+void setRasterThreads(int count);
+void setPostProcess(short mode);
+int setOutputSize(int columns, int rows);
+void setHalfBlockMode(short activate);
+void setColorMode(short mode);
+void setRunEncoding(short mode);
 void initProjectileQueue(ProjectileQueue *queue);
 void enqueueProjectile(ProjectileQueue *queue, Projectile proj);
 void dequeueProjectile(ProjectileQueue *queue);
@@ -113,27 +167,37 @@ Vec3 rotateY(Vec3 v, double theta);
 int projectileCuboidCollision(Projectile proj, Cuboid cuboid);
 Color blend(Color dst, Color src, float a);
 void drawLineZ_Wu(Vec3 c0, Vec3 c1, int width, int height, Color lineColor, FrameBuffer *frame);
+// Floating-point reference for drawLineZ_Wu (benchmarks and regression checks)
+void drawLineZ_WuFloat(Vec3 c0, Vec3 c1, int width, int height, Color lineColor, FrameBuffer *frame);
 void drawLineZ(Vec3 c0, Vec3 c1, int width, int height, Color lineColor, FrameBuffer * frame);
 void drawCuboid(const Cuboid cuboid);
 void drawGun(const Gun gun);
 void drawPlayer(const Player player);
+void drawPlayers(const Player *playerList, short count);
 void drawAllPlayers();
 void movePlayer(short playerID, double forward, double right, double up, short globalCoordinates);
 void rotatePlayer(short playerID, double delta_yaw);
 void changePlayerColor(short playerID, Color newColor);
-void drawProjectiles(ProjectileQueue *queue);
+void drawProjectiles(const ProjectileQueue *queue);
 void printProjectiles(ProjectileQueue *queue);
 void shootProjectile(short playerID, ProjectileQueue *queue);
 // Collision callback: (projectile_index, hit_player_id)
 typedef void (*CollisionCallback)(short, short);
-void updateProjectiles(ProjectileQueue *queue, Player *players, short numPlayers, double deltaTime, short checkCollisions, CollisionCallback onCollision);
+// Hitbox provider: (shooter_id) -> player states that shooter's projectiles are tested against
+typedef const Player *(*HitboxProvider)(short);
+void updateProjectiles(ProjectileQueue *queue, Player *players, short numPlayers, double deltaTime, short checkCollisions, CollisionCallback onCollision, HitboxProvider hitboxes);
 void clearScreen();
 void generateframeString();
+void invalidateFrame();
 void applyAA();
 void render();
+void startFrameWriter(int fd);
+void stopFrameWriter(void);
+int frameWriterReady(void);
 void ctrlcHandler(int signum);
 void moveCamera(Vec3 newPosition);
 void setCameraRotation(double theta);
+double getMonotonicTime(void);
 
 // ============== NETWORK PROTOCOL ==============
 
@@ -147,8 +211,8 @@ void setCameraRotation(double theta);
 #define CMD_NEW_PLAYER      6   // Server -> Client: New player joined
 #define CMD_ONBOARDING      7   // Server -> Client: Full game state for new player
 #define CMD_LOGIN_DENIED    8   // Server -> Client: Server full
-#define CMD_PING            9   // Ping
-#define CMD_PONG            10  // Pong
+#define CMD_PING            9   // Server -> Client: Sequenced, timestamped ping
+#define CMD_PONG            10  // Client -> Server: Echo of a ping
 #define CMD_TERMINATE       11  // Terminate
 #define CMD_PLAYER_KILLED   12  // Server -> Client: Player disconnected/killed
 // Chunked onboarding (avoids large single UDP datagrams / fragmentation issues)
@@ -165,6 +229,7 @@ typedef struct {
     double right;               // Right movement component
     double up;                  // Up movement component
     short rotation_direction;   // 0=stop, 1=right, 2=left
+    uint32_t input_seq;         // Client input sequence number (starts at 1)
 } CmdMoveRotate;
 
 // CMD_SHOOT payload - no additional data needed, just the command byte
@@ -180,6 +245,9 @@ typedef struct {
     double right;
     double up;
     short rotation_direction;
+    uint32_t input_seq;         // Last input of playerID applied (for client reconciliation)
+    double input_age;           // Seconds between applying input_seq and this state
+    double server_time;         // Server game time this state was sampled at
 } CmdMoveExecuted;
 
 // CMD_SHOOT_EXECUTED payload (Server -> Client)
@@ -210,6 +278,24 @@ typedef struct {
 
 // CMD_LOGIN_DENIED - no additional data
 
+// CMD_PING payload (Server -> Client)
+// send_time is on the server's clock and only meaningful to the server.
+// The server piggybacks its current link estimate so the client can see it too.
+typedef struct {
+    uint32_t sequence;
+    double send_time;
+    float srtt;                 // Smoothed round-trip time (seconds)
+    float rttvar;               // Round-trip time variation (seconds)
+    float loss_rate;            // Fraction of pings lost (0..1)
+} CmdPing;
+
+// CMD_PONG payload (Client -> Server), echoes the ping it answers
+typedef struct {
+    uint32_t sequence;
+    double echo_time;
+    float view_delay;           // Client's current interpolation delay (seconds)
+} CmdPong;
+
 // CMD_PLAYER_KILLED payload (Server -> Client)
 typedef struct {
     short playerID;
@@ -233,6 +319,9 @@ typedef struct {
 
 #pragma pack(pop)
 
+// Number of outstanding pings remembered per connection for RTT/loss matching
+#define PING_HISTORY 32
+
 // Player-subscriber mapping for O(1) lookup
 typedef struct {
     short subscriber_index;     // Index in subscribers array (-1 if not connected)
@@ -242,6 +331,17 @@ typedef struct {
     double right;               // Current right movement  
     double up;                  // Current up movement
     short rotation_direction;   // Current rotation direction
+    uint32_t last_input_seq;    // Sequence of the last applied CMD_MOVE_ROTATE
+    double last_input_time;     // Game time it was applied
+
+    // Link quality, maintained by the pinger from sequenced PING/PONG
+    double srtt;                // Smoothed round-trip time in seconds (0 until first sample)
+    double rttvar;              // Round-trip time variation in seconds
+    double loss_rate;           // Smoothed fraction of pings that got no pong
+    double view_delay;          // Client-reported interpolation delay in seconds
+    uint32_t ping_seq;          // Sequence number of the next ping
+    double ping_sent[PING_HISTORY];             // Send time per sequence slot
+    unsigned char ping_acked[PING_HISTORY];     // Whether that slot got its pong
 } PlayerConnection;
 
 #endif // GAME_H
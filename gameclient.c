@@ -9,6 +9,7 @@
 #include <pthread.h>
 #include <sys/time.h>
 #include <sys/select.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <stdint.h>
 #include <fcntl.h>
@@ -27,8 +28,33 @@
 
 #define MAX_CMD_SIZE 8192
 #define FRAME_INTERVAL_NS_CLIENT (16666667L)  // 60 FPS
+
+// Remote players are drawn this far in the past, between buffered snapshots
+#define DEFAULT_INTERP_DELAY 0.1    // Seconds (two 20 Hz server snapshots)
+#define MAX_EXTRAPOLATION 0.25      // Seconds to extrapolate past the newest snapshot
+#define SNAPSHOT_BUFFER 32          // Snapshots kept per remote player
+
+// Adaptive jitter buffer: the delay follows measured arrival jitter, and the
+// render clock runs slightly fast or slow to reach it instead of jumping
+#define MIN_INTERP_DELAY 0.05       // One server snapshot interval
+#define MAX_INTERP_DELAY 0.5
+#define JITTER_MARGIN 3.0           // Target delay = MIN_INTERP_DELAY + JITTER_MARGIN * jitter
+#define TIME_SCALE_GAIN 0.5         // Clock rate change per second of delay error
+#define MAX_TIME_SCALE_ADJUST 0.05  // Never run the render clock more than 5% off
+#define RESYNC_THRESHOLD 0.5        // Delay error (seconds) beyond which the clock jumps
 #define INPUT_SERVER_PORT 53850
 
+// Adaptive rendering: input, prediction and sends run every tick, frames are
+// rendered every render_divider-th tick, and quality steps down (post-process
+// AA off, then half-block off, then a lower frame rate) when rendering does
+// not fit its interval or the terminal cannot take the frames
+#define ADAPT_MAX_DIVIDER 4         // Lowest frame rate: 60 / 4 = 15 FPS
+#define ADAPT_LOWER_FRAMES 30       // Rendered frames measured before stepping down
+#define ADAPT_RAISE_FRAMES 120      // Rendered frames of headroom before stepping up
+#define ADAPT_OVER_BUDGET 0.8       // Step down above this share of the render interval
+#define ADAPT_HEADROOM 0.3          // Step up below this share
+#define ADAPT_SMOOTHING 0.1         // Weight of the newest frame in the render time average
+
 #define STUN_SERVER_ADDRESS "stun.l.google.com"
 #define STUN_SERVER_PORT 19302
 
@@ -203,6 +229,7 @@ typedef enum {
 
 static InputMethod current_input_method = INPUT_METHOD_NONE;
 static int evdev_fd = -1;
+static short evdev_monotonic = 0;   // Kernel stamps events on CLOCK_MONOTONIC
 static int input_server_fd = -1;
 static pthread_t input_thread;
 
@@ -215,6 +242,11 @@ static int connected = 0;
 static int receiver_terminated = 0;
 static int game_running = 0;
 
+// Link quality as measured by the server and reported in each PING
+static double link_srtt = 0;        // Smoothed round-trip time (seconds)
+static double link_rttvar = 0;      // Round-trip time variation (seconds)
+static double link_loss_rate = 0;   // Fraction of pings lost (0..1)
+
 // Chunked onboarding reassembly (avoids relying on UDP/IP fragmentation)
 static unsigned char onboarding_buf[sizeof(CmdOnboarding)];
 static uint32_t onboarding_total = 0;
@@ -231,8 +263,17 @@ static short prev_moving = 0;
 static short prev_rotating = 0;
 static double prev_forward = 0, prev_right = 0, prev_up = 0;
 static short prev_rot_dir = 0;
+static short shoot_pressed = 0;     // Space went down since the last check (input threads)
 static pthread_mutex_t input_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;  // Serializes send_input_changes()
 static volatile int input_thread_running = 0;
+static int input_wake_pipe[2] = {-1, -1};  // Written to stop the input thread
+
+// Key-to-send latency: when the oldest key event not yet acted on happened
+// (monotonic seconds, 0 if none; under input_mutex), and what was measured
+static double unsent_key_time = 0;
+static double key_latency_sum = 0, key_latency_max = 0;
+static unsigned long key_latency_count = 0;
 
 // Player movement state (for local simulation)
 typedef struct {
@@ -244,6 +285,71 @@ typedef struct {
 
 LocalPlayerMovement localMovement[16];
 
+// Client-side prediction: our inputs are applied locally as soon as they are
+// sent and kept until the server acknowledges them, so they can be replayed
+// on top of each authoritative position.
+#define PENDING_INPUTS 64
+
+typedef struct {
+    uint32_t seq;
+    double time;                // Local monotonic time the input took effect
+    LocalPlayerMovement movement;
+} PendingInput;
+
+static PendingInput pending_inputs[PENDING_INPUTS];
+static int pending_head = 0;
+static int pending_count = 0;
+static uint32_t next_input_seq = 1;
+static double predicted_until = 0;  // Local time our player is simulated up to
+
+// Snapshot interpolation for remote players, timestamped in server time
+typedef struct {
+    double server_time;
+    Vec3 position;
+    double rotation_y;
+    LocalPlayerMovement movement;
+} EntitySnapshot;
+
+typedef struct {
+    EntitySnapshot snapshots[SNAPSHOT_BUFFER];
+    int newest;                 // Index of the newest snapshot
+    int count;
+} SnapshotBuffer;
+
+static SnapshotBuffer remote_snapshots[16];
+static double interp_delay = DEFAULT_INTERP_DELAY;
+static int adaptive_delay = 1;          // Cleared by --interp-delay
+static double server_clock_offset = 0;  // Estimated server time minus local time
+static int server_clock_synced = 0;
+
+// Arrival statistics, measured in receiver_thread()
+static double arrival_jitter = 0;       // Smoothed transit time variation (seconds)
+static double last_transit = 0;
+static int transit_valid = 0;
+
+// Server time remote players are currently rendered at
+static double render_clock = 0;
+static int render_clock_valid = 0;
+
+// Adaptive render quality (see ADAPT_*)
+static int adapt_quality = 1;           // Cleared by --fixed-quality
+static int configured_post_process = POST_PROCESS_NONE;
+static int configured_half_block = 0;
+static int render_level = 0;            // Quality steps currently taken
+static int render_divider = 1;          // Render every this many ticks
+static double render_time_avg = 0;      // Smoothed seconds per rendered frame
+static int level_frames = 0;            // Frames due since render_level changed
+static int level_busy_frames = 0;       // ... of which the writer was still busy
+
+// Game state a frame is drawn from, copied at the start of the frame
+typedef struct {
+    Player players[16];
+    ProjectileQueue projectiles;
+    short my_player_id;
+} RenderSnapshot;
+
+static RenderSnapshot render_snapshot;
+
 // Mutexes for thread safety
 static pthread_mutex_t game_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -255,6 +361,7 @@ static void handle_onboarding(const unsigned char *data, int length);
 
 // Forward declarations for cleanup
 static void cleanup_input_system(void);
+static void send_input_changes(void);
 
 // Cleanup function registered with atexit - always runs on exit
 static void cleanup_all(void) {
@@ -266,15 +373,8 @@ static void cleanup_all(void) {
     receiver_terminated = 1;
     game_running = 0;
     
-    // Close input system (this will signal threads to stop)
-    if (current_input_method == INPUT_METHOD_EVDEV && evdev_fd >= 0) {
-        close(evdev_fd);
-        evdev_fd = -1;
-    }
-    if (current_input_method == INPUT_METHOD_NETWORK && input_server_fd >= 0) {
-        close(input_server_fd);
-        input_server_fd = -1;
-    }
+    // Wake and join the input thread, then close its device or socket
+    cleanup_input_system();
     
     // Close game socket
     if (sockfd >= 0) {
@@ -284,6 +384,7 @@ static void cleanup_all(void) {
     
     // Restore terminal (only if we modified it)
     if (terminal_initialized) {
+        stopFrameWriter();
         tcsetattr(STDIN_FILENO, TCSAFLUSH, &orig_termios);
         write(STDOUT_FILENO, "\033[?25h", 6);  // Show cursor
         write(STDOUT_FILENO, "\n", 1);
@@ -309,17 +410,41 @@ void set_raw_mode() {
     tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
 }
 
+// Set by SIGWINCH; the main loop refits the output at its next tick
+static volatile sig_atomic_t terminal_resized = 0;
+
+static void sigwinch_handler(int sig) {
+    (void)sig;
+    terminal_resized = 1;
+}
+
+// Size the framebuffer to the terminal: one cell per two columns and one per
+// line. Returns 1 if the size changed, 0 if it did not or could not be read
+// (output then stays at its current size).
+static int fit_output_to_terminal(void) {
+    struct winsize ws;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) < 0 || ws.ws_col < 2 || ws.ws_row < 1) return 0;
+    int columns = ws.ws_col / 2, rows = ws.ws_row;
+    if (columns == outputColumns && rows == outputRows) return 0;
+    if (setOutputSize(columns, rows) < 0) {
+        fprintf(stderr, "Out of memory for a %dx%d frame, keeping %dx%d\n", columns, rows, outputColumns, outputRows);
+        return 0;
+    }
+    return 1;
+}
+
 // ============================================================================
 // EVDEV INPUT SUPPORT
 // ============================================================================
 
 #ifdef __linux__
-// Map evdev keycodes to our internal key states
-static void handle_evdev_event(int code, int value) {
-    // value: 0 = release, 1 = press, 2 = repeat (we treat repeat as held)
+// Map evdev keycodes to our internal key states. value is 0 for a release and
+// 1 for a press; event_time is when it happened on the monotonic clock.
+static void handle_evdev_event(int code, int value, double event_time) {
     short state = (value != 0) ? 1 : 0;
     
     pthread_mutex_lock(&input_mutex);
+    if (unsent_key_time == 0) unsent_key_time = event_time;
     switch (code) {
         case KEY_W:
             key_w = state;
@@ -340,6 +465,7 @@ static void handle_evdev_event(int code, int value) {
             key_right = state;
             break;
         case KEY_SPACE:
+            if (value == 1) shoot_pressed = 1;
             key_space = state;
             break;
         case KEY_UP:
@@ -352,21 +478,50 @@ static void handle_evdev_event(int code, int value) {
     pthread_mutex_unlock(&input_mutex);
 }
 
-// Thread function for evdev input
+// Block until the input fd is readable or the wake pipe is written to.
+// Returns 1 when there is input, 0 when the thread should stop.
+static int wait_for_input(int fd) {
+    struct pollfd fds[2] = {
+        {.fd = fd, .events = POLLIN},
+        {.fd = input_wake_pipe[0], .events = POLLIN}
+    };
+    while (input_thread_running) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        if (fds[1].revents) return 0;
+        if (fds[0].revents & POLLNVAL) return 0;
+        if (fds[0].revents) return 1;  // Data, or an error/hangup the read reports
+    }
+    return 0;
+}
+
+// Thread function for evdev input: sleeps in poll() and drains every queued
+// event on each wakeup
 static void *evdev_input_thread(void *arg) {
     (void)arg;
-    struct input_event ev;
-    
-    while (input_thread_running && evdev_fd >= 0) {
-        ssize_t n = read(evdev_fd, &ev, sizeof(ev));
-        if (n == sizeof(ev)) {
-            if (ev.type == EV_KEY) {
-                handle_evdev_event(ev.code, ev.value);
+    struct input_event events[64];
+    
+    while (wait_for_input(evdev_fd)) {
+        ssize_t n;
+        short keys_changed = 0;
+        while ((n = read(evdev_fd, events, sizeof(events))) > 0) {
+            for (size_t i = 0; i < n / sizeof(events[0]); i++) {
+                // Autorepeat events (value 2) are dropped here: a held key
+                // stays pressed until its release, so they change nothing
+                if (events[i].type == EV_KEY && events[i].value != 2) {
+                    double event_time = evdev_monotonic
+                        ? events[i].input_event_sec + events[i].input_event_usec / 1000000.0
+                        : getMonotonicTime();
+                    handle_evdev_event(events[i].code, events[i].value, event_time);
+                    keys_changed = 1;
+                }
             }
-        } else if (n < 0 && errno != EAGAIN) {
-            break;
         }
-        usleep(1000); // Small sleep to prevent busy loop
+        int read_error = errno;     // send_input_changes() may overwrite errno
+        if (keys_changed) send_input_changes();
+        if (n == 0 || (n < 0 && read_error != EAGAIN && read_error != EINTR)) break;
     }
     return NULL;
 }
@@ -400,6 +555,10 @@ static int try_evdev_init(void) {
                 (keybit[KEY_A / (8 * sizeof(unsigned long))] & (1UL << (KEY_A % (8 * sizeof(unsigned long))))) &&
                 (keybit[KEY_S / (8 * sizeof(unsigned long))] & (1UL << (KEY_S % (8 * sizeof(unsigned long))))) &&
                 (keybit[KEY_D / (8 * sizeof(unsigned long))] & (1UL << (KEY_D % (8 * sizeof(unsigned long)))))) {
+                // Timestamp events on the clock getMonotonicTime() reads;
+                // if the device refuses, events are stamped when read instead
+                int clock_id = CLOCK_MONOTONIC;
+                evdev_monotonic = ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0;
                 evdev_fd = fd;
                 found = 1;
                 break;
@@ -411,7 +570,8 @@ static int try_evdev_init(void) {
     
     if (found) {
         input_thread_running = 1;
-        if (pthread_create(&input_thread, NULL, evdev_input_thread, NULL) != 0) {
+        if (input_wake_pipe[0] < 0 ||
+            pthread_create(&input_thread, NULL, evdev_input_thread, NULL) != 0) {
             close(evdev_fd);
             evdev_fd = -1;
             return 0;
@@ -432,10 +592,11 @@ static int try_evdev_init(void) { return 0; }
 // keycode: 'W', 'A', 'S', 'D', 'L' (left), 'R' (right), ' ' (space)
 // state: 0 = release, 1 = press
 
-static void handle_network_input(unsigned char keycode, unsigned char state) {
+static void handle_network_input(unsigned char keycode, unsigned char state, double event_time) {
     short key_state = (state != 0) ? 1 : 0;
     
     pthread_mutex_lock(&input_mutex);
+    if (unsent_key_time == 0) unsent_key_time = event_time;
     switch (keycode) {
         case 'W': case 'w':
             key_w = key_state;
@@ -456,6 +617,7 @@ static void handle_network_input(unsigned char keycode, unsigned char state) {
             key_right = key_state;
             break;
         case ' ': // Space
+            if (key_state && !key_space) shoot_pressed = 1;
             key_space = key_state;
             break;
         case 'U': case 'u': // Up arrow (mapped to W)
@@ -468,21 +630,29 @@ static void handle_network_input(unsigned char keycode, unsigned char state) {
     pthread_mutex_unlock(&input_mutex);
 }
 
-// Thread function for network input
+// Thread function for network input: sleeps in poll() and drains every
+// queued message on each wakeup. Events are timestamped on arrival.
 static void *network_input_thread(void *arg) {
     (void)arg;
-    unsigned char buffer[2];
-    
-    while (input_thread_running && input_server_fd >= 0) {
-        ssize_t n = recv(input_server_fd, buffer, 2, 0);
-        if (n == 2) {
-            handle_network_input(buffer[0], buffer[1]);
-        } else if (n <= 0) {
-            if (errno != EAGAIN && errno != EWOULDBLOCK) {
-                break; // Connection closed or error
+    unsigned char buffer[256];
+    size_t have = 0;  // A message split across reads leaves one byte here
+    
+    while (wait_for_input(input_server_fd)) {
+        ssize_t n;
+        while ((n = recv(input_server_fd, buffer + have, sizeof(buffer) - have, 0)) > 0) {
+            double event_time = getMonotonicTime();
+            have += n;
+            size_t i = 0;
+            for (; i + 2 <= have; i += 2) {
+                handle_network_input(buffer[i], buffer[i + 1], event_time);
             }
+            memmove(buffer, buffer + i, have - i);
+            have -= i;
+            if (i > 0) send_input_changes();
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            break; // Connection closed or error
         }
-        usleep(1000); // Small sleep to prevent busy loop
     }
     return NULL;
 }
@@ -517,7 +687,8 @@ static int try_network_input_init(void) {
     input_server_fd = fd;
     input_thread_running = 1;
     
-    if (pthread_create(&input_thread, NULL, network_input_thread, NULL) != 0) {
+    if (input_wake_pipe[0] < 0 ||
+        pthread_create(&input_thread, NULL, network_input_thread, NULL) != 0) {
         close(input_server_fd);
         input_server_fd = -1;
         return 0;
@@ -531,6 +702,11 @@ static int try_network_input_init(void) {
 // ============================================================================
 
 static void init_input_system(void) {
+    // Input threads block in poll() until input arrives or this is written to
+    if (pipe(input_wake_pipe) < 0) {
+        input_wake_pipe[0] = input_wake_pipe[1] = -1;
+    }
+
     // Try evdev first (native Linux with proper permissions)
 #ifdef __linux__
     if (try_evdev_init()) {
@@ -554,17 +730,24 @@ static void init_input_system(void) {
 
 static void cleanup_input_system(void) {
     input_thread_running = 0;
+    if (input_wake_pipe[1] >= 0) write(input_wake_pipe[1], "", 1);
     
     if (current_input_method == INPUT_METHOD_EVDEV && evdev_fd >= 0) {
+        pthread_join(input_thread, NULL);
         close(evdev_fd);
         evdev_fd = -1;
-        pthread_join(input_thread, NULL);
     }
     
     if (current_input_method == INPUT_METHOD_NETWORK && input_server_fd >= 0) {
+        pthread_join(input_thread, NULL);
         close(input_server_fd);
         input_server_fd = -1;
-        pthread_join(input_thread, NULL);
+    }
+
+    if (input_wake_pipe[0] >= 0) {
+        close(input_wake_pipe[0]);
+        close(input_wake_pipe[1]);
+        input_wake_pipe[0] = input_wake_pipe[1] = -1;
     }
 }
 
@@ -576,15 +759,8 @@ static void sigint_handler(int sig) {
     game_running = 0;
     input_thread_running = 0;
     
-    // Close file descriptors to unblock any threads waiting on I/O
-    if (evdev_fd >= 0) {
-        close(evdev_fd);
-        evdev_fd = -1;
-    }
-    if (input_server_fd >= 0) {
-        close(input_server_fd);
-        input_server_fd = -1;
-    }
+    // Wake the input thread out of poll(); its fd is closed after it is joined
+    if (input_wake_pipe[1] >= 0) write(input_wake_pipe[1], "", 1);
     
     // Note: cleanup_all() will be called by atexit() when we exit
     // Using _exit() would skip atexit handlers, so we just return
@@ -705,6 +881,9 @@ static void handle_onboarding(const unsigned char *data, int length) {
         localMovement[i].up = 0;
         localMovement[i].rotation_direction = 0;
     }
+    pending_head = 0;
+    pending_count = 0;
+    memset(remote_snapshots, 0, sizeof(remote_snapshots));
     
     game_running = 1;
     pthread_mutex_unlock(&game_mutex);
@@ -713,26 +892,219 @@ static void handle_onboarding(const unsigned char *data, int length) {
     fflush(stdout);
 }
 
-// Handle CMD_MOVE_EXECUTED
-void handle_move_executed(const unsigned char *data, int length) {
+// Place a player (and its gun) at a given position and rotation
+static void set_player_transform(short id, Vec3 position, double rotation_y) {
+    players[id].cuboid.position = position;
+    players[id].cuboid.rotation_y = rotation_y;
+    players[id].gun.position = position;
+    players[id].gun.position.y -= players[id].cuboid.height / 4.0;
+    players[id].gun.rotation_y = rotation_y;
+}
+
+// Advance one player by a movement state for delta_time seconds
+static void apply_movement(short id, const LocalPlayerMovement *m, double delta_time) {
+    if (m->forward != 0 || m->right != 0 || m->up != 0) {
+        movePlayer(id, m->forward * MOVE_SPEED * delta_time,
+                  m->right * MOVE_SPEED * delta_time,
+                  m->up * MOVE_SPEED * delta_time, 0);
+    }
+    if (m->rotation_direction == 1) {
+        rotatePlayer(id, ROTATION_SPEED * delta_time);
+    } else if (m->rotation_direction == 2) {
+        rotatePlayer(id, -ROTATION_SPEED * delta_time);
+    }
+}
+
+// Advance a player by a movement state in frame-sized steps, the way the
+// live simulation integrates it
+static void simulate_movement(short id, const LocalPlayerMovement *m, double duration) {
+    const double step = FRAME_INTERVAL_NS_CLIENT / 1000000000.0;
+    for (double remaining = duration; remaining > 0; remaining -= step) {
+        apply_movement(id, m, remaining < step ? remaining : step);
+    }
+}
+
+// Advance our player from local time from to time to, applying each pending
+// input for the part of that stretch it was in effect. Caller holds
+// game_mutex.
+static void advance_prediction(double from, double to) {
+    if (pending_count == 0) {
+        simulate_movement(my_player_id, &localMovement[my_player_id], to - from);
+        return;
+    }
+    for (int i = 0; i < pending_count && from < to; i++) {
+        const PendingInput *in = &pending_inputs[(pending_head + i) % PENDING_INPUTS];
+        double until = (i + 1 < pending_count) ?
+            pending_inputs[(pending_head + i + 1) % PENDING_INPUTS].time : to;
+        if (until > to) until = to;
+        if (until > from) {
+            simulate_movement(my_player_id, &in->movement, until - from);
+            from = until;
+        }
+    }
+}
+
+// Record an input we just sent and apply it to our player immediately.
+// Caller holds game_mutex.
+static void predict_input(uint32_t seq, const LocalPlayerMovement *movement) {
+    if (pending_count == PENDING_INPUTS) {
+        // Server is far behind; forget the oldest unacknowledged input
+        pending_head = (pending_head + 1) % PENDING_INPUTS;
+        pending_count--;
+    }
+    PendingInput *in = &pending_inputs[(pending_head + pending_count) % PENDING_INPUTS];
+    in->seq = seq;
+    in->time = getMonotonicTime();
+    in->movement = *movement;
+    pending_count++;
+
+    if (my_player_id >= 0 && my_player_id < 16) {
+        localMovement[my_player_id] = *movement;
+    }
+}
+
+// Server had applied input exec->input_seq for exec->input_age seconds when
+// our player was at exec->position: restart from there and replay the rest
+// of that input and every later one, each for as long as it was in effect
+// locally, up to predicted_until. The main loop carries on from there, so no
+// stretch of time is simulated twice. Caller holds game_mutex.
+static void reconcile_prediction(const CmdMoveExecuted *exec) {
+    int acked = -1;
+    for (int i = 0; i < pending_count; i++) {
+        if (pending_inputs[(pending_head + i) % PENDING_INPUTS].seq == exec->input_seq) {
+            acked = i;
+            break;
+        }
+    }
+    if (acked < 0) return;  // Stale or duplicate acknowledgement
+
+    // Inputs before the acknowledged one are settled
+    pending_head = (pending_head + acked) % PENDING_INPUTS;
+    pending_count -= acked;
+
+    set_player_transform(my_player_id, exec->position, exec->rotation_y);
+
+    advance_prediction(pending_inputs[pending_head].time + exec->input_age, predicted_until);
+}
+
+// Fold one server-timestamped arrival into the clock offset and the
+// interarrival jitter estimate (RFC 3550 style, gain 1/16). Caller holds
+// game_mutex.
+static void measure_arrival(double server_time, double recv_time) {
+    // Track the server clock as seen from here (includes the one-way delay)
+    double offset = server_time - recv_time;
+    if (!server_clock_synced) {
+        server_clock_offset = offset;
+        server_clock_synced = 1;
+    } else {
+        server_clock_offset += (offset - server_clock_offset) * 0.05;
+    }
+
+    double transit = recv_time - server_time;
+    if (transit_valid) {
+        arrival_jitter += (fabs(transit - last_transit) - arrival_jitter) / 16.0;
+    }
+    last_transit = transit;
+    transit_valid = 1;
+}
+
+// Advance the render clock by one frame. The delay target follows the
+// measured jitter, and the clock speed is trimmed by a few percent until
+// the buffered depth matches it, so remote motion never visibly jumps.
+static double advance_render_clock(double delta_time) {
+    if (adaptive_delay) {
+        double target = MIN_INTERP_DELAY + JITTER_MARGIN * arrival_jitter;
+        interp_delay = (target > MAX_INTERP_DELAY) ? MAX_INTERP_DELAY : target;
+    }
+
+    double server_now = getMonotonicTime() + server_clock_offset;
+    double error = (server_now - render_clock) - interp_delay;  // > 0: rendering too far back
+    if (!render_clock_valid || fabs(error) > RESYNC_THRESHOLD) {
+        render_clock = server_now - interp_delay;
+        render_clock_valid = server_clock_synced;
+        return render_clock;
+    }
+
+    double adjust = error * TIME_SCALE_GAIN;
+    if (adjust > MAX_TIME_SCALE_ADJUST) adjust = MAX_TIME_SCALE_ADJUST;
+    if (adjust < -MAX_TIME_SCALE_ADJUST) adjust = -MAX_TIME_SCALE_ADJUST;
+    render_clock += delta_time * (1.0 + adjust);
+    return render_clock;
+}
+
+// Buffer a remote player's state for interpolation. Caller holds game_mutex.
+static void push_snapshot(const CmdMoveExecuted *exec) {
+    SnapshotBuffer *buf = &remote_snapshots[exec->playerID];
+    if (buf->count > 0 && exec->server_time <= buf->snapshots[buf->newest].server_time) {
+        return;  // Reordered or duplicate
+    }
+    buf->newest = (buf->newest + 1) % SNAPSHOT_BUFFER;
+    if (buf->count < SNAPSHOT_BUFFER) buf->count++;
+
+    EntitySnapshot *snap = &buf->snapshots[buf->newest];
+    snap->server_time = exec->server_time;
+    snap->position = exec->position;
+    snap->rotation_y = exec->rotation_y;
+    snap->movement.forward = exec->forward;
+    snap->movement.right = exec->right;
+    snap->movement.up = exec->up;
+    snap->movement.rotation_direction = exec->rotation_direction;
+}
+
+// Place a remote player where it was at render_time (server clock):
+// interpolate between the bracketing snapshots, or extrapolate a little
+// from the newest one when the buffer runs dry. Caller holds game_mutex.
+static void sample_remote_player(short id, double render_time) {
+    SnapshotBuffer *buf = &remote_snapshots[id];
+    if (buf->count == 0) return;  // Nothing heard yet; keep onboarding state
+
+    const EntitySnapshot *newest = &buf->snapshots[buf->newest];
+    if (render_time >= newest->server_time) {
+        double ahead = render_time - newest->server_time;
+        if (ahead > MAX_EXTRAPOLATION) ahead = MAX_EXTRAPOLATION;
+        set_player_transform(id, newest->position, newest->rotation_y);
+        simulate_movement(id, &newest->movement, ahead);
+        return;
+    }
+
+    // Walk back to the newest snapshot at or before render_time
+    int later = buf->newest;
+    int earlier = later;
+    for (int n = 1; n < buf->count && buf->snapshots[earlier].server_time > render_time; n++) {
+        later = earlier;
+        earlier = (earlier - 1 + SNAPSHOT_BUFFER) % SNAPSHOT_BUFFER;
+    }
+
+    const EntitySnapshot *a = &buf->snapshots[earlier];
+    const EntitySnapshot *b = &buf->snapshots[later];
+    if (render_time <= a->server_time || b->server_time <= a->server_time) {
+        set_player_transform(id, a->position, a->rotation_y);
+        return;
+    }
+
+    double t = (render_time - a->server_time) / (b->server_time - a->server_time);
+    Vec3 position = {
+        a->position.x + (b->position.x - a->position.x) * t,
+        a->position.y + (b->position.y - a->position.y) * t,
+        a->position.z + (b->position.z - a->position.z) * t
+    };
+    set_player_transform(id, position, a->rotation_y + (b->rotation_y - a->rotation_y) * t);
+}
+
+// Handle CMD_MOVE_EXECUTED, received at recv_time
+void handle_move_executed(const unsigned char *data, int length, double recv_time) {
     if (length < sizeof(CmdMoveExecuted)) return;
     
     CmdMoveExecuted *exec = (CmdMoveExecuted*)data;
     
     pthread_mutex_lock(&game_mutex);
-    if (exec->playerID >= 0 && exec->playerID < 16) {
-        // Teleport player to server position and rotation
-        players[exec->playerID].cuboid.position = exec->position;
-        players[exec->playerID].cuboid.rotation_y = exec->rotation_y;
-        players[exec->playerID].gun.position = exec->position;
-        players[exec->playerID].gun.position.y -= players[exec->playerID].cuboid.height / 4.0;
-        players[exec->playerID].gun.rotation_y = exec->rotation_y;
-        
-        // Update local movement state
-        localMovement[exec->playerID].forward = exec->forward;
-        localMovement[exec->playerID].right = exec->right;
-        localMovement[exec->playerID].up = exec->up;
-        localMovement[exec->playerID].rotation_direction = exec->rotation_direction;
+    measure_arrival(exec->server_time, recv_time);
+    if (exec->playerID == my_player_id) {
+        // Our own movement is predicted locally
+        reconcile_prediction(exec);
+    } else if (exec->playerID >= 0 && exec->playerID < 16) {
+        // Remote players are drawn from their snapshot history
+        push_snapshot(exec);
     }
     pthread_mutex_unlock(&game_mutex);
 }
@@ -749,7 +1121,7 @@ void handle_shoot_executed(const unsigned char *data, int length) {
     proj.position = exec->gun_position;
     proj.length = 3.0;
     proj.rotation_y = exec->gun_rotation_y;
-    proj.color = (Color){255, 255, 255};
+    proj.color = (Color){255, 255, 255, 0};
     proj.distance_left = PROJECTILE_TRAVEL_DISTANCE;
     proj.speed = PROJECTILE_TRAVEL_SPEED;
     proj.ownerID = exec->playerID;
@@ -769,7 +1141,7 @@ void handle_projectile_hit(const unsigned char *data, int length) {
         players[hit->hit_playerID].hp -= 1;
         unsigned char newRed = (players[hit->hit_playerID].cuboid.color.red <= 204) ? (players[hit->hit_playerID].cuboid.color.red + 51) : 255;
         unsigned char newGreen = (players[hit->hit_playerID].cuboid.color.green >= 51) ? (players[hit->hit_playerID].cuboid.color.green - 51) : 0;
-        changePlayerColor(hit->hit_playerID, (Color){newRed, newGreen, 0});
+        changePlayerColor(hit->hit_playerID, (Color){newRed, newGreen, 0, 0});
     }
     // Mark projectile as collided if we have the index
     if (hit->projectile_index >= 0 && hit->projectile_index < 64) {
@@ -791,6 +1163,7 @@ void handle_new_player(const unsigned char *data, int length) {
         localMovement[newPlayer->playerID].right = 0;
         localMovement[newPlayer->playerID].up = 0;
         localMovement[newPlayer->playerID].rotation_direction = 0;
+        remote_snapshots[newPlayer->playerID].count = 0;
     }
     pthread_mutex_unlock(&game_mutex);
 }
@@ -808,6 +1181,26 @@ void handle_player_killed(const unsigned char *data, int length) {
     pthread_mutex_unlock(&game_mutex);
 }
 
+// Handle CMD_PING: echo sequence and timestamp, keep the server's link estimate
+void handle_ping(const unsigned char *data, int length) {
+    if (length < sizeof(CmdPing)) {
+        // Bare ping (e.g. from the server console): liveness only
+        send_command(CMD_PONG, NULL, 0);
+        return;
+    }
+
+    CmdPing *ping = (CmdPing*)data;
+    CmdPong pong;
+    pong.sequence = ping->sequence;
+    pong.echo_time = ping->send_time;
+    pong.view_delay = (float)interp_delay;
+    send_command(CMD_PONG, &pong, sizeof(pong));
+
+    link_srtt = ping->srtt;
+    link_rttvar = ping->rttvar;
+    link_loss_rate = ping->loss_rate;
+}
+
 // Handle CMD_LOGIN_DENIED
 void handle_login_denied() {
     printf("Server is full. Cannot join.\n");
@@ -819,8 +1212,12 @@ void *receiver_thread(void *arg) {
     unsigned char buffer[MAX_CMD_SIZE];
     struct sockaddr_in6 from_addr;
     socklen_t from_len = sizeof(from_addr);
+    struct pollfd pfd = {.fd = sockfd, .events = POLLIN};
 
     while (!receiver_terminated) {
+        // Sleep until a packet arrives (the socket is non-blocking for the
+        // main loop's sends); the timeout bounds how long shutdown waits
+        if (poll(&pfd, 1, 100) <= 0) continue;
         int n = recvfrom(sockfd, buffer, sizeof(buffer), 0,
                          (struct sockaddr*)&from_addr, &from_len);
         if (n < 0) {
@@ -829,14 +1226,14 @@ void *receiver_thread(void *arg) {
         
         if (n < 1) continue;
         
+        double recv_time = getMonotonicTime();
         unsigned char cmd_code = buffer[0];
         unsigned char *payload = buffer + 1;
         int payload_len = n - 1;
 
         switch (cmd_code) {
             case CMD_PING:
-                // Respond with PONG
-                send_command(CMD_PONG, NULL, 0);
+                handle_ping(payload, payload_len);
                 break;
                 
             case CMD_TERMINATE:
@@ -863,7 +1260,7 @@ void *receiver_thread(void *arg) {
                 break;
                 
             case CMD_MOVE_EXECUTED:
-                handle_move_executed(payload, payload_len);
+                handle_move_executed(payload, payload_len, recv_time);
                 break;
                 
             case CMD_SHOOT_EXECUTED:
@@ -946,11 +1343,13 @@ short check_shoot() {
         pthread_mutex_lock(&input_mutex);
     }
     
-    // Shoot on key press (transition from not pressed to pressed)
-    if (key_space && !key_space_prev) {
+    // Shoot on key press (transition from not pressed to pressed). Input
+    // threads latch presses, so a tap inside one batch of events still counts.
+    if ((key_space && !key_space_prev) || shoot_pressed) {
         should_shoot = 1;
     }
     key_space_prev = key_space;
+    shoot_pressed = 0;
     
     if (current_input_method != INPUT_METHOD_TERMINAL) {
         pthread_mutex_unlock(&input_mutex);
@@ -1032,9 +1431,187 @@ void reset_key_states() {
     }
 }
 
+// Called once input has been acted on: if a command went out, record how
+// long after the oldest pending key event it left
+static void account_key_latency(short sent) {
+    pthread_mutex_lock(&input_mutex);
+    double event_time = unsent_key_time;
+    unsent_key_time = 0;
+    pthread_mutex_unlock(&input_mutex);
+    if (!sent || event_time == 0) return;
+
+    double latency = getMonotonicTime() - event_time;
+    key_latency_sum += latency;
+    if (latency > key_latency_max) key_latency_max = latency;
+    key_latency_count++;
+}
+
+// Send what the keys changed since the last send: a shot on a space press,
+// and a move/rotate command when the movement differs from the last one sent.
+// Input threads call this right after each batch of key events, the main loop
+// once a tick for terminal input.
+static void send_input_changes(void) {
+    pthread_mutex_lock(&send_mutex);
+
+    // Check for shooting
+    short sent_input = 0;
+    if (check_shoot()) {
+        send_command(CMD_SHOOT, NULL, 0);
+        sent_input = 1;
+    }
+
+    // Calculate current movement state
+    double forward, right, up;
+    get_movement_direction(&forward, &right, &up);
+    short rot_dir = get_rotation_direction();
+
+    // Check if movement state changed (use epsilon for float comparison to avoid precision issues)
+    const double EPSILON = 0.0001;
+    short moving = (forward != 0 || right != 0 || up != 0);
+    short rotating = (rot_dir != 0);
+    
+    int forward_changed = (fabs(forward - prev_forward) > EPSILON);
+    int right_changed = (fabs(right - prev_right) > EPSILON);
+    int up_changed = (fabs(up - prev_up) > EPSILON);
+    int rot_changed = (rot_dir != prev_rot_dir);
+    int stop_moving = (prev_moving && !moving);
+    int stop_rotating = (prev_rotating && !rotating);
+
+    if (forward_changed || right_changed || up_changed || rot_changed || stop_moving || stop_rotating) {
+        // Send move command
+        CmdMoveRotate cmd;
+        cmd.forward = forward;
+        cmd.right = right;
+        cmd.up = up;
+        cmd.rotation_direction = rot_dir;
+        cmd.input_seq = next_input_seq++;
+        send_command(CMD_MOVE_ROTATE, &cmd, sizeof(cmd));
+        sent_input = 1;
+
+        // Apply it locally right away instead of waiting for the echo
+        LocalPlayerMovement movement = {forward, right, up, rot_dir};
+        pthread_mutex_lock(&game_mutex);
+        predict_input(cmd.input_seq, &movement);
+        pthread_mutex_unlock(&game_mutex);
+        
+        prev_forward = forward;
+        prev_right = right;
+        prev_up = up;
+        prev_rot_dir = rot_dir;
+    }
+
+    prev_moving = moving;
+    prev_rotating = rotating;
+    account_key_latency(sent_input);
+
+    pthread_mutex_unlock(&send_mutex);
+}
+
+// Copy what a frame is drawn from. Caller holds game_mutex.
+static void take_render_snapshot(void) {
+    memcpy(render_snapshot.players, players, sizeof(render_snapshot.players));
+    render_snapshot.projectiles = projectileQueue;
+    render_snapshot.my_player_id = my_player_id;
+}
+
+// Draw and hand off a frame from render_snapshot, without holding any lock
+static void render_from_snapshot(void) {
+    const RenderSnapshot *snap = &render_snapshot;
+
+    // Camera follows our player
+    short id = snap->my_player_id;
+    if (id >= 0 && id < 16) {
+        Vec3 cam_offset = {0, 2.0, -8.0};  // Behind and above player
+        cam_offset = rotateY(cam_offset, snap->players[id].cuboid.rotation_y);
+        Vec3 cam_pos = {
+            snap->players[id].cuboid.position.x + cam_offset.x,
+            snap->players[id].cuboid.position.y + cam_offset.y,
+            snap->players[id].cuboid.position.z + cam_offset.z
+        };
+        moveCamera(cam_pos);
+        setCameraRotation(snap->players[id].cuboid.rotation_y);
+    }
+
+    clearScreen();
+    drawProjectiles(&snap->projectiles);
+    drawPlayers(snap->players, 16);
+    if (activePostProcess == POST_PROCESS_AA) applyAA();
+    generateframeString();
+    render();
+}
+
+// Number of quality steps available with the configured options
+static int render_level_count(void) {
+    return (configured_post_process != POST_PROCESS_NONE) + configured_half_block + ADAPT_MAX_DIVIDER - 1;
+}
+
+// Apply the first `level` quality steps: drop the post-process, then
+// half-block output (halving the pixels rendered into the same cells), then
+// render one frame in 2, 3, ... ticks
+static void apply_render_level(int level) {
+    int post_process = configured_post_process;
+    int half_block = configured_half_block;
+    if (post_process != POST_PROCESS_NONE && level > 0) {
+        post_process = POST_PROCESS_NONE;
+        level--;
+    }
+    if (half_block && level > 0) {
+        half_block = 0;
+        level--;
+    }
+    render_divider = 1 + level;
+
+    if (post_process != activePostProcess) setPostProcess(post_process);
+    if (half_block != halfBlockMode) setHalfBlockMode(half_block);
+}
+
+// Account one frame that was due: rendered in `seconds`, or skipped because
+// the writer was still busy. Steps quality down when frames overrun their
+// interval or a quarter of them find the terminal busy, and back up after a
+// longer stretch with ample headroom.
+static void adapt_render_level(double seconds, short writer_busy) {
+    if (writer_busy) {
+        level_busy_frames++;
+    } else if (render_time_avg == 0) {
+        render_time_avg = seconds;
+    } else {
+        render_time_avg += ADAPT_SMOOTHING * (seconds - render_time_avg);
+    }
+    level_frames++;
+    if (!adapt_quality || level_frames < ADAPT_LOWER_FRAMES) return;
+
+    double budget = render_divider * (FRAME_INTERVAL_NS_CLIENT / 1000000000.0);
+    int level = render_level;
+    if ((render_time_avg > ADAPT_OVER_BUDGET * budget || level_busy_frames * 4 > level_frames) &&
+        render_level < render_level_count()) {
+        level++;
+    } else if (level_frames >= ADAPT_RAISE_FRAMES && render_level > 0 &&
+               render_time_avg < ADAPT_HEADROOM * budget && level_busy_frames == 0) {
+        level--;
+    } else if (level_frames < ADAPT_RAISE_FRAMES) {
+        return;
+    }
+
+    if (level != render_level) {
+        render_level = level;
+        apply_render_level(level);
+        render_time_avg = 0;
+    }
+    level_frames = 0;
+    level_busy_frames = 0;
+}
+
 int main(int argc, char *argv[]) {
     char server_ip[256];
     int use_msaa = 1;  // Default to MSAA on
+    int hidden_edges = 0;
+    int raster_threads = 0;  // 0 means one per online CPU
+    int post_process = POST_PROCESS_NONE;
+    int half_block = 0;
+    int color_mode = COLOR_MODE_TRUECOLOR;
+    // Runs are opt-in: ECH needs background color erase and REP is missing
+    // from many terminals that set TERM=xterm, and neither shows in $TERM
+    int run_encoding = RUN_ENCODING_NONE;
     int client_port = 0;  // 0 means OS assigns random port
     
     // Register cleanup handler - runs on any exit
@@ -1044,6 +1621,43 @@ int main(int argc, char *argv[]) {
     for (int i = 1; i < argc; i++) {
         if (strcmp(argv[i], "--noaa") == 0) {
             use_msaa = 0;
+        } else if (strcmp(argv[i], "--hidden-edges") == 0) {
+            hidden_edges = 1;
+        } else if (strcmp(argv[i], "--post-aa") == 0) {
+            post_process = POST_PROCESS_AA;
+        } else if (strcmp(argv[i], "--half-block") == 0) {
+            half_block = 1;
+        } else if (strcmp(argv[i], "--fixed-quality") == 0) {
+            adapt_quality = 0;
+        } else if (strcmp(argv[i], "--colors") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "256") == 0) {
+                color_mode = COLOR_MODE_256;
+            } else if (strcmp(argv[i + 1], "16") == 0) {
+                color_mode = COLOR_MODE_16;
+            } else if (strcmp(argv[i + 1], "truecolor") != 0) {
+                fprintf(stderr, "Invalid color mode (truecolor, 256 or 16): %s\n", argv[i + 1]);
+                exit(1);
+            }
+            i++;  // Skip next argument
+        } else if (strcmp(argv[i], "--run-encoding") == 0 && i + 1 < argc) {
+            if (strcmp(argv[i + 1], "none") == 0) {
+                run_encoding = RUN_ENCODING_NONE;
+            } else if (strcmp(argv[i + 1], "erase") == 0) {
+                run_encoding = RUN_ENCODING_ERASE;
+            } else if (strcmp(argv[i + 1], "repeat") == 0) {
+                run_encoding = RUN_ENCODING_REPEAT;
+            } else {
+                fprintf(stderr, "Invalid run encoding (none, erase or repeat): %s\n", argv[i + 1]);
+                exit(1);
+            }
+            i++;  // Skip next argument
+        } else if (strcmp(argv[i], "--raster-threads") == 0 && i + 1 < argc) {
+            raster_threads = atoi(argv[i + 1]);
+            if (raster_threads < 1 || raster_threads > RASTER_MAX_THREADS) {
+                fprintf(stderr, "Invalid raster thread count (1-%d): %s\n", RASTER_MAX_THREADS, argv[i + 1]);
+                exit(1);
+            }
+            i++;  // Skip next argument
         } else if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
             client_port = atoi(argv[i + 1]);
             if (client_port <= 0 || client_port > 65535) {
@@ -1051,11 +1665,32 @@ int main(int argc, char *argv[]) {
                 exit(1);
             }
             i++;  // Skip next argument
+        } else if (strcmp(argv[i], "--interp-delay") == 0 && i + 1 < argc) {
+            int delay_ms = atoi(argv[i + 1]);
+            if (delay_ms < 0 || delay_ms > 1000) {
+                fprintf(stderr, "Invalid interpolation delay (0-1000 ms): %s\n", argv[i + 1]);
+                exit(1);
+            }
+            interp_delay = delay_ms / 1000.0;
+            adaptive_delay = 0;
+            i++;  // Skip next argument
         }
     }
     
     // Set MSAA mode
     setActiveMSAA(use_msaa);
+    setHiddenEdgeRemoval(hidden_edges);
+    if (raster_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        raster_threads = cpus > 0 ? (int)cpus : 1;
+    }
+    setRasterThreads(raster_threads);
+    setPostProcess(post_process);
+    setHalfBlockMode(half_block);
+    configured_post_process = post_process;
+    configured_half_block = half_block;
+    setColorMode(color_mode);
+    setRunEncoding(run_encoding);
     
     printf("Enter server IPv6 address (e.g., ::1 or [::1]:8080): ");
     if (fgets(server_ip, sizeof(server_ip), stdin) == NULL) {
@@ -1222,6 +1857,7 @@ int main(int argc, char *argv[]) {
     
     // Install signal handler for clean exit
     signal(SIGINT, sigint_handler);
+    signal(SIGWINCH, sigwinch_handler);
     
     // Initialize input system (tries evdev, then network, then terminal fallback)
     init_input_system();
@@ -1231,11 +1867,19 @@ int main(int argc, char *argv[]) {
     
     // Clear screen
     write(STDOUT_FILENO, "\033[2J\033[H", 7);
+    fit_output_to_terminal();
+
+    // Frames are written to the terminal by their own thread from here on
+    startFrameWriter(STDOUT_FILENO);
 
     // Main game loop
     struct timespec next_frame, current, prev_frame;
     clock_gettime(CLOCK_MONOTONIC, &next_frame);
     prev_frame = next_frame;
+    pthread_mutex_lock(&game_mutex);
+    predicted_until = prev_frame.tv_sec + prev_frame.tv_nsec / 1000000000.0;
+    pthread_mutex_unlock(&game_mutex);
+    unsigned long tick = 0;
 
     while (!receiver_terminated && game_running) {
         // Calculate next frame time
@@ -1254,103 +1898,86 @@ int main(int argc, char *argv[]) {
                            (current.tv_nsec - prev_frame.tv_nsec) / 1000000000.0;
         prev_frame = current;
 
+        // After an overrun of more than a tick, drop the missed ticks instead
+        // of running them back to back
+        double behind = (current.tv_sec - next_frame.tv_sec) +
+                        (current.tv_nsec - next_frame.tv_nsec) / 1000000000.0;
+        if (behind > FRAME_INTERVAL_NS_CLIENT / 1000000000.0) next_frame = current;
+
         // Process input
         process_input();
 
-        // Check for shooting
-        if (check_shoot()) {
-            send_command(CMD_SHOOT, NULL, 0);
-        }
-
-        // Calculate current movement state
-        double forward, right, up;
-        get_movement_direction(&forward, &right, &up);
-        short rot_dir = get_rotation_direction();
-
-        // Check if movement state changed (use epsilon for float comparison to avoid precision issues)
-        const double EPSILON = 0.0001;
-        short moving = (forward != 0 || right != 0 || up != 0);
-        short rotating = (rot_dir != 0);
-        
-        int forward_changed = (fabs(forward - prev_forward) > EPSILON);
-        int right_changed = (fabs(right - prev_right) > EPSILON);
-        int up_changed = (fabs(up - prev_up) > EPSILON);
-        int rot_changed = (rot_dir != prev_rot_dir);
-        int stop_moving = (prev_moving && !moving);
-        int stop_rotating = (prev_rotating && !rotating);
-
-        if (forward_changed || right_changed || up_changed || rot_changed || stop_moving || stop_rotating) {
-            // Send move command
-            CmdMoveRotate cmd;
-            cmd.forward = forward;
-            cmd.right = right;
-            cmd.up = up;
-            cmd.rotation_direction = rot_dir;
-            send_command(CMD_MOVE_ROTATE, &cmd, sizeof(cmd));
-            
-            prev_forward = forward;
-            prev_right = right;
-            prev_up = up;
-            prev_rot_dir = rot_dir;
+        // Input threads send as soon as keys change; terminal input is only
+        // read here, once a tick
+        if (current_input_method == INPUT_METHOD_TERMINAL) {
+            send_input_changes();
         }
 
-        prev_moving = moving;
-        prev_rotating = rotating;
-
         // Reset key states for next frame
         reset_key_states();
 
         // Update game state locally
         pthread_mutex_lock(&game_mutex);
         
-        // Move all players based on their movement state
+        // Move our (predicted) player the same way reconcile_prediction()
+        // replays it; place the others from their snapshots
+        double render_time = advance_render_clock(delta_time);
+        double now = current.tv_sec + current.tv_nsec / 1000000000.0;
         for (short i = 0; i < 16; i++) {
-            if (players[i].hp > 0) {
-                double fwd = localMovement[i].forward;
-                double rgt = localMovement[i].right;
-                double up_mov = localMovement[i].up;
-                short rot = localMovement[i].rotation_direction;
-                
-                if (fwd != 0 || rgt != 0 || up_mov != 0) {
-                    movePlayer(i, fwd * MOVE_SPEED * delta_time, 
-                              rgt * MOVE_SPEED * delta_time, 
-                              up_mov * MOVE_SPEED * delta_time, 0);
-                }
-                if (rot == 1) {
-                    rotatePlayer(i, ROTATION_SPEED * delta_time);
-                } else if (rot == 2) {
-                    rotatePlayer(i, -ROTATION_SPEED * delta_time);
-                }
+            if (players[i].hp <= 0) continue;
+            if (i == my_player_id) {
+                advance_prediction(predicted_until, now);
+            } else {
+                sample_remote_player(i, render_time);
             }
         }
+        predicted_until = now;
 
         // Update projectiles (no collision check on client, no callback)
-        updateProjectiles(&projectileQueue, players, 16, delta_time, 0, NULL);
-
-        // Update camera to follow our player
-        if (my_player_id >= 0 && my_player_id < 16) {
-            Vec3 cam_offset = {0, 2.0, -8.0};  // Behind and above player
-            cam_offset = rotateY(cam_offset, players[my_player_id].cuboid.rotation_y);
-            Vec3 cam_pos = {
-                players[my_player_id].cuboid.position.x + cam_offset.x,
-                players[my_player_id].cuboid.position.y + cam_offset.y,
-                players[my_player_id].cuboid.position.z + cam_offset.z
-            };
-            moveCamera(cam_pos);
-            setCameraRotation(players[my_player_id].cuboid.rotation_y);
+        updateProjectiles(&projectileQueue, players, 16, delta_time, 0, NULL, NULL);
+
+        // Render every render_divider-th tick, unless the terminal is still
+        // taking the previous frame. The frame is drawn from a copy of the
+        // game state taken here, so packet handlers only ever wait for the
+        // simulation step and this copy, never for rendering.
+        short render_frame = 0;
+        short writer_busy = 0;
+        if (tick++ % render_divider == 0) {
+            render_frame = frameWriterReady();
+            if (render_frame) take_render_snapshot();
+            else writer_busy = 1;
         }
 
-        // Render
-        clearScreen();
-        drawProjectiles(&projectileQueue);
-        drawAllPlayers();
-        generateframeString();
-        render();
-        
         pthread_mutex_unlock(&game_mutex);
+
+        // Follow terminal resizes. setOutputSize() waits for the writer to
+        // go idle, so the wrapped old frame can be cleared directly.
+        if (terminal_resized) {
+            terminal_resized = 0;
+            if (fit_output_to_terminal()) write(STDOUT_FILENO, "\033[2J", 4);
+        }
+
+        if (render_frame) {
+            double render_start = getMonotonicTime();
+            render_from_snapshot();
+            adapt_render_level(getMonotonicTime() - render_start, 0);
+        } else if (writer_busy) {
+            adapt_render_level(0, 1);
+        }
     }
 
     // Note: atexit(cleanup_all) handles all cleanup automatically
-    printf("\nClient terminated.\n");
+    stopFrameWriter();  // Let the last frame finish before printing below it
+    printf("\nClient terminated. Last link estimate: RTT %.1f ms (+/- %.1f ms), loss %.1f%%\n",
+           link_srtt * 1000.0, link_rttvar * 1000.0, link_loss_rate * 100.0);
+    printf("Frames dropped while the terminal was busy: %lu\n", droppedFrames);
+    printf("Render quality at exit: %d of %d steps down, one frame every %d ticks\n",
+           render_level, render_level_count(), render_divider);
+    pthread_mutex_lock(&send_mutex);
+    if (key_latency_count > 0) {
+        printf("Key-to-send latency: %.2f ms average, %.2f ms worst over %lu inputs\n",
+               key_latency_sum / key_latency_count * 1000.0, key_latency_max * 1000.0, key_latency_count);
+    }
+    pthread_mutex_unlock(&send_mutex);
     return 0;
 }
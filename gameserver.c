@@ -14,6 +14,22 @@
 #define MAX_CMD_SIZE 256
 #define SHOOT_COOLDOWN 4.0  // 4 seconds between shots
 
+// Link measurement: ping often enough for a responsive RTT estimate,
+// but only drop a subscriber after a long silence.
+#define PING_INTERVAL_MS 250
+#define PING_TIMEOUT 15.0       // Seconds without a pong before a subscriber is dropped
+#define PING_LOSS_DELAY 4       // A ping is counted lost if unanswered this many pings later
+#define PING_LOSS_GAIN 0.0625   // EWMA weight of each loss sample (1/16)
+
+// Lag compensation: keep ~1 s of player transforms at the tick rate and
+// test hits against the world as each shooter saw it
+#define HISTORY_TICKS 64
+#define MAX_REWIND 1.0          // Seconds; never rewind further than this
+
+// Moving players' states are broadcast every this many ticks (20 Hz) so
+// clients can interpolate between snapshots
+#define SNAPSHOT_INTERVAL_TICKS 3
+
 #define STUN_SERVER_ADDRESS "stun.l.google.com"
 #define STUN_SERVER_PORT 19302
 
@@ -227,6 +243,7 @@ typedef struct connection_info {
     socklen_t addr_len;
     short active;
     short pinged;
+    double last_pong_time;      // Monotonic time of the last PONG (or login)
 } conn_info;
 
 conn_info subscribers[512];
@@ -237,6 +254,9 @@ PlayerConnection playerConnections[16];
 typedef struct pong_response {
     struct sockaddr_in6 addr;
     socklen_t addr_len;
+    double recv_time;           // Monotonic time the PONG was received
+    short has_payload;          // 0 for a bare PONG (liveness only)
+    CmdPong pong;
 } pong_resp;
 
 typedef struct pinger_queue {
@@ -304,6 +324,23 @@ static int server_sockfd;  // Global socket for sending
 // Game timing
 static double game_time = 0.0;
 
+// Ring buffer of past player transforms (written by the swapper only)
+typedef struct {
+    double time;
+    Vec3 position[16];
+    double rotation_y[16];
+    unsigned int life[16];      // player_life of a living occupant, 0 if none
+} transform_snapshot;
+
+// Bumped each time a slot gets a new living occupant, so history recorded for
+// an earlier occupant of the slot is never used for the current one
+static unsigned int player_life[16];
+
+static transform_snapshot transform_history[HISTORY_TICKS];
+static int history_head = 0;    // Next slot to write
+static int history_count = 0;
+static Player rewound_players[16];
+
 static void send_onboarding_chunked(const struct sockaddr_in6 *client_addr, socklen_t addr_len, short player_id) {
     CmdOnboarding onboard;
     onboard.assigned_playerID = player_id;
@@ -386,7 +423,8 @@ void init_pinger_queue(pinger_q *q) {
     q->tail = 0;
 }
 
-int enqueue_pong(pinger_q *q, const struct sockaddr_in6 *addr, socklen_t addr_len) {
+int enqueue_pong(pinger_q *q, const struct sockaddr_in6 *addr, socklen_t addr_len,
+                 const unsigned char *payload, int payload_len, double recv_time) {
     int rc = 0;
     pthread_mutex_lock(&ping_mutex);
     if (((q->tail + 1) & 511) == q->head) {
@@ -394,6 +432,11 @@ int enqueue_pong(pinger_q *q, const struct sockaddr_in6 *addr, socklen_t addr_le
     } else {
         memcpy(&q->responses[q->tail].addr, addr, sizeof(struct sockaddr_in6));
         q->responses[q->tail].addr_len = addr_len;
+        q->responses[q->tail].recv_time = recv_time;
+        q->responses[q->tail].has_payload = (payload_len >= (int)sizeof(CmdPong));
+        if (q->responses[q->tail].has_payload) {
+            memcpy(&q->responses[q->tail].pong, payload, sizeof(CmdPong));
+        }
         q->tail = (q->tail + 1) & 511;
     }
     pthread_mutex_unlock(&ping_mutex);
@@ -406,8 +449,7 @@ int dequeue_pong(pinger_q *q, pong_resp * resp) {
     if (q->head == q->tail) {
         rc = -1;
     } else {
-        memcpy(&resp->addr, &q->responses[q->head].addr, sizeof(struct sockaddr_in6));
-        resp->addr_len = q->responses[q->head].addr_len;
+        memcpy(resp, &q->responses[q->head], sizeof(pong_resp));
         q->head = (q->head + 1) & 511;
     }
     pthread_mutex_unlock(&ping_mutex);
@@ -561,6 +603,7 @@ void handle_login(const struct sockaddr_in6 *client_addr, socklen_t addr_len) {
                 subscribers[i].addr_len = addr_len;
                 subscribers[i].active = 1;
                 subscribers[i].pinged = 0;
+                subscribers[i].last_pong_time = getMonotonicTime();
                 subscriber_idx = i;
                 break;
             }
@@ -584,6 +627,15 @@ void handle_login(const struct sockaddr_in6 *client_addr, socklen_t addr_len) {
     playerConnections[player_id].right = 0;
     playerConnections[player_id].up = 0;
     playerConnections[player_id].rotation_direction = 0;
+    playerConnections[player_id].last_input_seq = 0;
+    playerConnections[player_id].last_input_time = game_time;
+    playerConnections[player_id].view_delay = 0;
+    playerConnections[player_id].srtt = 0;
+    playerConnections[player_id].rttvar = 0;
+    playerConnections[player_id].loss_rate = 0;
+    playerConnections[player_id].ping_seq = 0;
+    memset(playerConnections[player_id].ping_sent, 0, sizeof(playerConnections[player_id].ping_sent));
+    memset(playerConnections[player_id].ping_acked, 0, sizeof(playerConnections[player_id].ping_acked));
     
     // Setup player game state
     players[player_id].cuboid = (Cuboid){
@@ -602,6 +654,7 @@ void handle_login(const struct sockaddr_in6 *client_addr, socklen_t addr_len) {
     };
     players[player_id].gun.position.y -= players[player_id].cuboid.height / 4.0;
     players[player_id].hp = 5;
+    if (++player_life[player_id] == 0) player_life[player_id] = 1;
     
     printf("Player %d logged in (subscriber %d)\n", player_id, subscriber_idx);
     fflush(stdout);
@@ -621,6 +674,11 @@ void handle_login(const struct sockaddr_in6 *client_addr, socklen_t addr_len) {
 // Handle CMD_MOVE_ROTATE
 void handle_move_rotate(short player_id, const CmdMoveRotate *cmd) {
     if (player_id < 0 || player_id >= 16 || !playerConnections[player_id].active) return;
+
+    // Drop inputs that were overtaken by a newer one in flight
+    if ((int32_t)(cmd->input_seq - playerConnections[player_id].last_input_seq) <= 0) return;
+    playerConnections[player_id].last_input_seq = cmd->input_seq;
+    playerConnections[player_id].last_input_time = game_time;
     
     playerConnections[player_id].forward = cmd->forward;
     playerConnections[player_id].right = cmd->right;
@@ -638,6 +696,9 @@ void handle_move_rotate(short player_id, const CmdMoveRotate *cmd) {
     exec->right = cmd->right;
     exec->up = cmd->up;
     exec->rotation_direction = cmd->rotation_direction;
+    exec->input_seq = cmd->input_seq;
+    exec->input_age = 0;
+    exec->server_time = game_time;
     enqueue_out(producer_q, response, sizeof(response), -1, -1, &prod_mutex);
 }
 
@@ -740,7 +801,13 @@ void receiver() {
 
         unsigned char cmd_code = buffer[0];
 
-        // Log received command with IP (skip PONG and MOVE_ROTATE for less noise)
+        // Handle PONG before logging; they arrive several times a second per client
+        if (cmd_code == CMD_PONG) {
+            enqueue_pong(&ping_queue, &client_addr, addr_len, buffer + 1, n - 1, getMonotonicTime());
+            continue;
+        }
+
+        // Log received command with IP
         char ip_str[INET6_ADDRSTRLEN];
         if (client_addr.sin6_family == AF_INET6) {
             // Check if it's an IPv4-mapped IPv6 address
@@ -759,12 +826,7 @@ void receiver() {
                 cmd_code, ip_str, ntohs(client_addr.sin6_port), n);
         fflush(stdout);
         
-        // Handle PING/PONG/TERMINATE immediately in receiver
-        if (cmd_code == CMD_PONG) {
-            enqueue_pong(&ping_queue, &client_addr, addr_len);
-            continue;
-        }
-        
+        // Handle TERMINATE immediately in receiver
         if (cmd_code == CMD_TERMINATE) {
             printf("\n\nTERMINATE received; server exiting.\n");
             fflush(stdout);
@@ -791,6 +853,85 @@ void receiver() {
     close(server_sockfd);
 }
 
+// Record this tick's player transforms for lag compensation
+static void record_transforms(void) {
+    transform_snapshot *snap = &transform_history[history_head];
+    snap->time = game_time;
+    for (short i = 0; i < 16; i++) {
+        snap->position[i] = players[i].cuboid.position;
+        snap->rotation_y[i] = players[i].cuboid.rotation_y;
+        snap->life[i] = (playerConnections[i].active && players[i].hp > 0) ? player_life[i] : 0;
+    }
+    history_head = (history_head + 1) % HISTORY_TICKS;
+    if (history_count < HISTORY_TICKS) history_count++;
+}
+
+// Broadcast the state of every moving player (periodic snapshot)
+static void broadcast_snapshots(void) {
+    unsigned char response[1 + sizeof(CmdMoveExecuted)];
+    response[0] = CMD_MOVE_EXECUTED;
+    CmdMoveExecuted *exec = (CmdMoveExecuted*)(response + 1);
+
+    for (short i = 0; i < 16; i++) {
+        PlayerConnection *conn = &playerConnections[i];
+        if (!conn->active || players[i].hp <= 0) continue;
+        if (conn->forward == 0 && conn->right == 0 && conn->up == 0 && conn->rotation_direction == 0) continue;
+
+        exec->playerID = i;
+        exec->position = players[i].cuboid.position;
+        exec->rotation_y = players[i].cuboid.rotation_y;
+        exec->forward = conn->forward;
+        exec->right = conn->right;
+        exec->up = conn->up;
+        exec->rotation_direction = conn->rotation_direction;
+        exec->input_seq = conn->last_input_seq;
+        exec->input_age = game_time - conn->last_input_time;
+        exec->server_time = game_time;
+        enqueue_out(producer_q, response, sizeof(response), -1, -1, &prod_mutex);
+    }
+}
+
+// Hitbox provider: players rewound to what the shooter saw (one-way latency
+// plus its interpolation delay), interpolated between the two recorded ticks
+// that bracket that moment. Players that were not alive in their current life
+// at both ticks keep their live transform.
+static const Player *rewound_hitboxes(short shooter_id) {
+    if (shooter_id < 0 || shooter_id >= 16 || history_count == 0) return players;
+
+    // One-way latency plus how far in the past the client renders others
+    double rewind = playerConnections[shooter_id].srtt / 2.0 + playerConnections[shooter_id].view_delay;
+    if (rewind <= 0.0) return players;
+    if (rewind > MAX_REWIND) rewind = MAX_REWIND;
+    double target = game_time - rewind;
+
+    // Walk back from the newest snapshot to the first one at or before target
+    int newer = (history_head - 1 + HISTORY_TICKS) % HISTORY_TICKS;
+    int older = newer;
+    for (int n = 1; n < history_count && transform_history[older].time > target; n++) {
+        newer = older;
+        older = (older - 1 + HISTORY_TICKS) % HISTORY_TICKS;
+    }
+
+    const transform_snapshot *a = &transform_history[older];
+    const transform_snapshot *b = &transform_history[newer];
+    double t = 0.0;
+    if (b->time > a->time && target > a->time) {
+        t = (target - a->time) / (b->time - a->time);
+        if (t > 1.0) t = 1.0;
+    }
+
+    memcpy(rewound_players, players, sizeof(rewound_players));
+    for (short i = 0; i < 16; i++) {
+        if (a->life[i] != player_life[i] || b->life[i] != player_life[i]) continue;
+        Cuboid *c = &rewound_players[i].cuboid;
+        c->position.x = a->position[i].x + (b->position[i].x - a->position[i].x) * t;
+        c->position.y = a->position[i].y + (b->position[i].y - a->position[i].y) * t;
+        c->position.z = a->position[i].z + (b->position[i].z - a->position[i].z) * t;
+        c->rotation_y = a->rotation_y[i] + (b->rotation_y[i] - a->rotation_y[i]) * t;
+    }
+    return rewound_players;
+}
+
 // Collision callback - broadcasts CMD_PROJECTILE_HIT to all subscribers
 void on_projectile_collision(short proj_index, short hit_player) {
     unsigned char response[1 + sizeof(CmdProjectileHit)];
@@ -803,6 +944,7 @@ void on_projectile_collision(short proj_index, short hit_player) {
 
 void swapper() {
     struct timespec next_frame, current, prev_frame;
+    unsigned long tick = 0;
     
     clock_gettime(CLOCK_MONOTONIC, &next_frame);
     prev_frame = next_frame;
@@ -855,8 +997,14 @@ void swapper() {
             }
         }
 
-        // Update projectiles and check for collisions (callback broadcasts collision events)
-        updateProjectiles(&projectileQueue, players, 16, delta_time, 1, on_projectile_collision);
+        record_transforms();
+        if (++tick % SNAPSHOT_INTERVAL_TICKS == 0) {
+            broadcast_snapshots();
+        }
+
+        // Update projectiles and check for collisions against rewound hitboxes
+        // (callback broadcasts collision events)
+        updateProjectiles(&projectileQueue, players, 16, delta_time, 1, on_projectile_collision, rewound_hitboxes);
 
         // Calculate next frame time
         next_frame.tv_nsec += INTERVAL_NS;
@@ -914,42 +1062,88 @@ void sender() {
     }
 }
 
+// Fold one RTT sample into the smoothed estimate (RFC 6298 gains)
+static void update_rtt(PlayerConnection *conn, double rtt) {
+    if (conn->srtt <= 0.0) {
+        conn->srtt = rtt;
+        conn->rttvar = rtt / 2.0;
+    } else {
+        conn->rttvar = 0.75 * conn->rttvar + 0.25 * fabs(conn->srtt - rtt);
+        conn->srtt = 0.875 * conn->srtt + 0.125 * rtt;
+    }
+}
+
+// Match a PONG to the ping it answers and take an RTT sample
+static void record_pong(PlayerConnection *conn, const CmdPong *pong, double recv_time) {
+    uint32_t age = conn->ping_seq - pong->sequence;
+    if (age == 0 || age > PING_LOSS_DELAY) return;  // Unknown, or already counted lost
+
+    int slot = pong->sequence % PING_HISTORY;
+    if (conn->ping_acked[slot] || conn->ping_sent[slot] != pong->echo_time) return;
+
+    conn->ping_acked[slot] = 1;
+    update_rtt(conn, recv_time - conn->ping_sent[slot]);
+
+    double view_delay = pong->view_delay;
+    conn->view_delay = (view_delay < 0) ? 0 : (view_delay > MAX_REWIND) ? MAX_REWIND : view_delay;
+}
+
+// Stamp the next ping for a connection, settling the loss sample of the
+// ping sent PING_LOSS_DELAY intervals ago
+static void prepare_ping(PlayerConnection *conn, CmdPing *ping, double now) {
+    if (conn->ping_seq >= PING_LOSS_DELAY) {
+        int old_slot = (conn->ping_seq - PING_LOSS_DELAY) % PING_HISTORY;
+        double lost = conn->ping_acked[old_slot] ? 0.0 : 1.0;
+        conn->loss_rate += (lost - conn->loss_rate) * PING_LOSS_GAIN;
+    }
+
+    int slot = conn->ping_seq % PING_HISTORY;
+    conn->ping_sent[slot] = now;
+    conn->ping_acked[slot] = 0;
+
+    ping->sequence = conn->ping_seq++;
+    ping->send_time = now;
+    ping->srtt = (float)conn->srtt;
+    ping->rttvar = (float)conn->rttvar;
+    ping->loss_rate = (float)conn->loss_rate;
+}
+
 void pinger() {
-    unsigned char ping_msg[1] = {CMD_PING};
+    unsigned char ping_msg[1 + sizeof(CmdPing)];
+    ping_msg[0] = CMD_PING;
+    CmdPing *ping = (CmdPing *)(ping_msg + 1);
 
     while (1) {
-        sleep(15);
-
-        int response_count = 0;
-        pong_resp responses[512];
-        while (dequeue_pong(&ping_queue, &responses[response_count]) == 0) {
-            response_count++;
-            if (response_count >= 512) break;
+        usleep(PING_INTERVAL_MS * 1000);
+
+        pong_resp resp;
+        while (dequeue_pong(&ping_queue, &resp) == 0) {
+            short subscriber_idx = find_subscriber(&resp.addr);
+            if (subscriber_idx < 0) continue;
+            subscribers[subscriber_idx].last_pong_time = resp.recv_time;
+            if (!resp.has_payload) continue;
+
+            short player_id = find_player_by_subscriber(subscriber_idx);
+            if (player_id >= 0) {
+                record_pong(&playerConnections[player_id], &resp.pong, resp.recv_time);
+            }
         }
 
+        double now = getMonotonicTime();
         for (int i = 0; i < 512; i++) {
-            if (subscribers[i].active && subscribers[i].pinged) {
-                int ponged = 0;
-                for (int j = 0; j < response_count; j++) {
-                    if (memcmp(&subscribers[i].addr, &responses[j].addr, 
-                              sizeof(struct sockaddr_in6)) == 0) {
-                        ponged = 1;
-                        break;
-                    }
-                }
-                if (!ponged) {
-                    // Find and kill the player
-                    short player_id = find_player_by_subscriber(i);
-                    if (player_id >= 0) {
-                        printf("Player %d timed out\n", player_id);
-                        kill_player(player_id);
-                        playerConnections[player_id].active = 0;
-                    }
-                    subscribers[i].active = 0;
-                    subscribers[i].pinged = 0;
-                    printf("Subscriber %d timed out and removed.\n", i);
-                    fflush(stdout);
+            if (subscribers[i].active && subscribers[i].pinged &&
+                now - subscribers[i].last_pong_time > PING_TIMEOUT) {
+                // Find and kill the player
+                short player_id = find_player_by_subscriber(i);
+                if (player_id >= 0) {
+                    printf("Player %d timed out\n", player_id);
+                    kill_player(player_id);
+                    playerConnections[player_id].active = 0;
                 }
+                subscribers[i].active = 0;
+                subscribers[i].pinged = 0;
+                printf("Subscriber %d timed out and removed.\n", i);
+                fflush(stdout);
             }
         }
 
@@ -962,8 +1156,15 @@ void pinger() {
         // Send PING to all active subscribers
         for (int i = 0; i < 512; i++) {
             if (subscribers[i].active) {
+                short player_id = find_player_by_subscriber(i);
+                if (player_id >= 0) {
+                    prepare_ping(&playerConnections[player_id], ping, now);
+                } else {
+                    memset(ping, 0, sizeof(CmdPing));
+                    ping->send_time = now;
+                }
                 subscribers[i].pinged = 1;
-                sendto(server_sockfd, ping_msg, 1, 0,
+                sendto(server_sockfd, ping_msg, sizeof(ping_msg), 0,
                        (struct sockaddr*)&subscribers[i].addr,
                        subscribers[i].addr_len);
             }
@@ -1027,9 +1228,21 @@ void consumer() {
     }
 }
 
+// Print per-player link quality (operator view)
+static void print_link_stats(void) {
+    printf("Player  RTT(ms)  RTTVAR(ms)  Loss(%%)\n");
+    for (short i = 0; i < 16; i++) {
+        if (!playerConnections[i].active) continue;
+        printf("%6d  %7.1f  %10.1f  %7.1f\n", i,
+               playerConnections[i].srtt * 1000.0,
+               playerConnections[i].rttvar * 1000.0,
+               playerConnections[i].loss_rate * 100.0);
+    }
+}
+
 void stdin_command_reader() {
     char input[512];
-    printf("\nType IP:port to ping (e.g., 192.168.1.100:12345 or [::1]:8080)\n");
+    printf("\nType IP:port to ping (e.g., 192.168.1.100:12345 or [::1]:8080), or 'stats' for link quality\n");
     fflush(stdout);
     
     while (1) {
@@ -1041,6 +1254,12 @@ void stdin_command_reader() {
         input[strcspn(input, "\n")] = '\0';
         
         if (strlen(input) == 0) continue;
+
+        if (strcmp(input, "stats") == 0) {
+            print_link_stats();
+            fflush(stdout);
+            continue;
+        }
         
         // Parse IP:port
         char addr_str[256];